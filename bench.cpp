@@ -0,0 +1,1210 @@
+#include "kuznechik.h"
+#include "kuznechik_mac.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <x86intrin.h>
+#define KUZNECHIK_BENCH_TSC
+#endif
+
+// Замеры производительности: отдельные преобразования, шифрование блока и сквозное шифрование
+// по режимам, размерам данных и числу потоков. Результат — JSON в стандартный вывод
+//
+// Ключи:
+// --engine=table|simd|bitsliced|reference — движок для сквозных замеров (по умолчанию simd)
+// --max-size=<байт> — наибольший размер данных (по умолчанию 256 МБ, размеры растут в 16 раз от 16 байт)
+// --time-limit=<секунд> — серия прекращается, когда один прогон дольше (по умолчанию 2 с)
+// --verify — вместо замеров сверить все движки с эталонным шифрованием (см. verify), код возврата 1 при расхождении
+// --seed=<число> — начальное значение случайных ключей и данных для --verify
+
+// Счётчик тактов: TSC на x86 (тикает с номинальной частотой), иначе такты не сообщаются
+static uint64_t read_cycles()
+{
+#ifdef KUZNECHIK_BENCH_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Результат замера: время и такты на одну операцию
+struct measurement
+{
+    double seconds = 0; // На одну операцию
+    double cycles = 0; // На одну операцию (0, если счётчика нет)
+};
+
+// Повторяет run(iterations) с удвоением числа повторов, пока замер не займёт хотя бы minimum_time
+template <typename F>
+static measurement measure(F run, double minimum_time = 0.2)
+{
+    for (uint64_t iterations = 1;; iterations *= 2)
+    {
+        double start = now();
+        uint64_t start_cycles = read_cycles();
+        run(iterations);
+        uint64_t end_cycles = read_cycles();
+        double elapsed = now() - start;
+        if (elapsed >= minimum_time || iterations >= (1ULL << 40))
+        {
+            measurement result;
+            result.seconds = elapsed / iterations;
+            result.cycles = (double)(end_cycles - start_cycles) / iterations;
+            return result;
+        }
+    }
+}
+
+// Результаты вычислений складываются сюда, чтобы компилятор их не выбросил
+static volatile uint64_t sink;
+
+// Доступ к закрытым преобразованиям kuznechik
+class kuznechik_bench
+{
+    public:
+        static const int group_size = kuznechik::group_size;
+        static const size_t parallel_grain = kuznechik::parallel_grain;
+        static unsigned char GF_mul(unsigned char a, unsigned char b) { return kuznechik::GF_mul(a, b); }
+        static unsigned char get_mask_value(int index) { return kuznechik::get_mask_value(index); }
+        static block S(const block& b) { return kuznechik::S(b); }
+        static block S_reversed(const block& b) { return kuznechik::S_reversed(b); }
+        static block R(const block& b) { return kuznechik::R(b); }
+        static block R_reversed(const block& b) { return kuznechik::R_reversed(b); }
+        static block L(const block& b) { return kuznechik::L(b); }
+        static block L_reversed(const block& b) { return kuznechik::L_reversed(b); }
+        static block encrypt_block(const kuznechik& cipher, const block& b) { return cipher.encrypt_block(b); }
+        static block decrypt_block(const kuznechik& cipher, const block& b) { return cipher.decrypt_block(b); }
+        static block decrypt_block_table(const kuznechik& cipher, const block& b) { return cipher.decrypt_block_table(b); }
+        static void encrypt_chunk(const kuznechik& cipher, block blocks[], size_t count) { block chaining_block = cipher.initialization_vector; acpkm_chain acpkm; cipher.encrypt_chunk(blocks, count, 0, chaining_block, acpkm); }
+        static void decrypt_chunk(const kuznechik& cipher, block blocks[], size_t count) { block chaining_block = cipher.initialization_vector; acpkm_chain acpkm; cipher.decrypt_chunk(blocks, count, 0, chaining_block, acpkm); }
+};
+
+static const char* engine_name(engine_type engine)
+{
+    switch (engine)
+    {
+        case engine_type::reference: return "reference";
+        case engine_type::table: return "table";
+        case engine_type::simd: return "simd";
+        default: return "bitsliced";
+    }
+}
+
+static const char* mode_name(cipher_mode mode)
+{
+    switch (mode)
+    {
+        case cipher_mode::ecb: return "ecb";
+        case cipher_mode::ctr: return "ctr";
+        case cipher_mode::ctr_acpkm: return "ctr-acpkm";
+        case cipher_mode::cbc: return "cbc";
+        case cipher_mode::cfb: return "cfb";
+        case cipher_mode::ofb: return "ofb";
+        default: return "mgm";
+    }
+}
+
+// Строка JSON-массива с замером на операцию; bytes — байтов на операцию (0 — не пересчитывать на байт)
+static void print_operation(bool& first, const char* name, const char* engine, const measurement& result, double bytes)
+{
+    std::printf("%s\n    {\"name\": \"%s\"", first ? "" : ",", name);
+    if (engine != nullptr)
+        std::printf(", \"engine\": \"%s\"", engine);
+    std::printf(", \"ns_per_op\": %.3f", result.seconds * 1e9);
+#ifdef KUZNECHIK_BENCH_TSC
+    std::printf(", \"cycles_per_op\": %.2f", result.cycles);
+    if (bytes != 0)
+        std::printf(", \"cycles_per_byte\": %.3f", result.cycles / bytes);
+#endif
+    if (bytes != 0)
+        std::printf(", \"gb_per_s\": %.4f", bytes / result.seconds / 1e9);
+    std::printf("}");
+    first = false;
+}
+
+// Сверка движков с эталоном: эталон — шифрование блока через S, L и GF_mul (encrypt_block, decrypt_block)
+// и режимы на эталонном движке. Результат — JSON в стандартный вывод, подробности расхождений — в stderr
+//
+// - gost: векторы ГОСТ Р 34.12-2015 (приложение А) для S, R, L, развёртывания ключа и шифрования блока.
+//   Строки векторов записаны от байта 15 к байту 0. Реализация отличается от стандарта умножением GF_mul
+//   (приведение по модулю выполняется при нулевом старшем бите) и итерационными константами, поэтому
+//   сходятся только векторы S; остальные выводятся для сведения и в код возврата не входят
+// - standard: эталон стандарта (standard_cipher, без отступлений реализации) и эталонные режимы по векторам
+//   ГОСТ Р 34.12-2015, ГОСТ Р 34.13-2015, RFC 8645 и RFC 9058; входят в код возврата
+// - standard_modes: режимы реализации (и mgm_encrypt, cmac) против эталонных режимов над блочным шифром самой реализации
+// - transforms: R против определения (сдвиг и сумма ℓ), S⁻¹∘S, R⁻¹∘R и L⁻¹∘L на случайных блоках
+// - blocks: encrypt_blocks и decrypt_blocks каждого движка на каждом доступном наборе инструкций против
+//   encrypt_block и decrypt_block, случайные ключи, число блоков вокруг границ групп
+// - modes: encrypt и decrypt через span во всех режимах на случайных данных всех размеров вокруг границ блоков,
+//   групп и кусков пула: каждый движок × число потоков × выравнивание буфера × на месте против эталонного движка
+// - batch: ctr_crypt_batch (многоключевые ядра) табличного и векторного движков на каждом наборе инструкций,
+//   свои ключ и синхропосылка у каждого сообщения, каждое сообщение против ctr_crypt эталонного движка
+// - speedup: блоков в секунду каждым движком против эталона в одном потоке
+
+// Блок из строки вектора ГОСТ: первые два символа — байт 15
+static block gost_block(const char* hexadecimal)
+{
+    unsigned char bytes[block::size];
+    bool valid = hex_decode(hexadecimal, 2 * block::size, bytes);
+    assert(valid && "Wrong test vector");
+    (void)valid;
+    std::reverse(bytes, bytes + block::size);
+    return block(bytes);
+}
+
+// R по определению: байты сдвигаются к нулевому, в байт 15 — ℓ = сумма GF_mul(a_i, маска_i)
+static block specified_R(const block& input_block)
+{
+    unsigned char bytes[block::size];
+    unsigned char sum = 0;
+    for (int i = 0; i < block::size; i++)
+    {
+        sum ^= kuznechik_bench::GF_mul(input_block[i], kuznechik_bench::get_mask_value(i));
+        if (i != 0)
+            bytes[i - 1] = input_block[i];
+    }
+    bytes[block::size - 1] = sum;
+    return block(bytes);
+}
+
+static block random_block(std::mt19937_64& generator)
+{
+    const uint64_t low = generator();
+    return block(low, generator());
+}
+
+// Эталон ГОСТ Р 34.12-2015 без отступлений реализации: GF_mul приводит произведение при единичном старшем
+// бите, итерационные константы C_i = L(i), i = 1…32. Блоки — в порядке ядра (байт 15 — старший); S и
+// коэффициенты ℓ общие с kuznechik, их векторы сверяются отдельно
+class standard_cipher
+{
+    public:
+        standard_cipher(const block& key_1, const block& key_2)
+        {
+            keys[0] = key_1;
+            keys[1] = key_2;
+            block left = key_1, right = key_2;
+            for (int i = 0; i < 32; i++)
+            {
+                const block next = L(kuznechik_bench::S(left ^ L(block(i + 1, 0)))) ^ right;
+                right = left;
+                left = next;
+                if (i % 8 == 7)
+                {
+                    keys[2 * (i / 8) + 2] = left;
+                    keys[2 * (i / 8) + 3] = right;
+                }
+            }
+        }
+        block encrypt(block b) const
+        {
+            for (int i = 0; i < 9; i++)
+                b = L(kuznechik_bench::S(b ^ keys[i]));
+            return b ^ keys[9];
+        }
+        block decrypt(block b) const
+        {
+            b ^= keys[9];
+            for (int i = 8; i >= 0; i--)
+                b = kuznechik_bench::S_reversed(L_reversed(b)) ^ keys[i];
+            return b;
+        }
+        const block& iteration_key(int index) const { return keys[index]; }
+
+        static unsigned char GF_mul(unsigned char a, unsigned char b)
+        {
+            unsigned char product = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                if (b & (1 << i))
+                    product ^= a;
+                a = (unsigned char)((a << 1) ^ (a & 0x80 ? 0xC3 : 0)); // x^8 = x^7 + x^6 + x + 1
+            }
+            return product;
+        }
+        // R: байты сдвигаются к нулевому, в байт 15 — ℓ(a_15, …, a_0)
+        static block R(const block& b)
+        {
+            unsigned char bytes[block::size];
+            unsigned char sum = 0;
+            for (int i = 0; i < block::size; i++)
+            {
+                sum ^= GF_mul(b[i], kuznechik_bench::get_mask_value(i));
+                if (i != 0)
+                    bytes[i - 1] = b[i];
+            }
+            bytes[block::size - 1] = sum;
+            return block(bytes);
+        }
+        static block R_reversed(const block& b)
+        {
+            unsigned char bytes[block::size];
+            unsigned char sum = b[block::size - 1];
+            for (int i = 1; i < block::size; i++)
+            {
+                bytes[i] = b[i - 1];
+                sum ^= GF_mul(bytes[i], kuznechik_bench::get_mask_value(i));
+            }
+            bytes[0] = sum; // Коэффициент ℓ при a_0 равен 1
+            return block(bytes);
+        }
+        static block L(block b)
+        {
+            for (int i = 0; i < block::size; i++)
+                b = R(b);
+            return b;
+        }
+        static block L_reversed(block b)
+        {
+            for (int i = 0; i < block::size; i++)
+                b = R_reversed(b);
+            return b;
+        }
+
+    private:
+        block keys[10];
+};
+
+// Блочный шифр реализации для эталонных режимов: encrypt_block (эталонный движок kuznechik)
+class library_cipher
+{
+    public:
+        library_cipher(const block& key_1, const block& key_2) : cipher(key_1, key_2) {}
+        block encrypt(const block& b) const { return kuznechik_bench::encrypt_block(cipher, b); }
+
+    private:
+        kuznechik cipher;
+};
+
+// Эталонные режимы над блочным шифром cipher (standard_cipher или library_cipher) по тексту стандартов
+// Данные — в раскладке реализации: блок хранится от байта 0 (младшего) к байту 15. Неполный последний блок
+// в режимах гаммирования — начало блока гаммы в памяти (младшие байты, как в ctr_crypt), в MGM и
+// имитовставке — старшие байты блока (MSB_u стандартов), записанные так же от младшего к старшему
+typedef std::vector<unsigned char> byte_string;
+
+// Блок данных с номером index: неполный последний — младшие (high = false) или старшие байты, остальные нулевые
+static block data_block(const byte_string& data, size_t index, bool high = false)
+{
+    const size_t length = std::min(data.size() - index * block::size, (size_t)block::size);
+    unsigned char bytes[block::size] = {};
+    memcpy(bytes + (high ? block::size - length : 0), data.data() + index * block::size, length);
+    return block(bytes);
+}
+
+// Наложение блока гаммы на блок данных с номером index (неполный — младшими или старшими байтами гаммы)
+static void apply_gamma(byte_string& data, size_t index, const block& gamma, bool high = false)
+{
+    const size_t length = std::min(data.size() - index * block::size, (size_t)block::size);
+    unsigned char bytes[block::size];
+    gamma.store(bytes);
+    for (size_t k = 0; k < length; k++)
+        data[index * block::size + k] ^= bytes[(high ? block::size - length : 0) + k];
+}
+
+static size_t number_of_blocks(const byte_string& data) { return (data.size() + block::size - 1) / block::size; }
+
+template <typename cipher_type>
+static byte_string reference_ecb(const cipher_type& cipher, byte_string data)
+{
+    for (size_t i = 0; i < number_of_blocks(data); i++)
+        cipher.encrypt(data_block(data, i)).store(data.data() + i * block::size);
+    return data;
+}
+
+// CTR: CTR_1 = IV || 0, гамма — E(CTR_i)
+template <typename cipher_type>
+static byte_string reference_ctr(const cipher_type& cipher, uint64_t initialization_vector, byte_string data)
+{
+    for (size_t i = 0; i < number_of_blocks(data); i++)
+        apply_gamma(data, i, cipher.encrypt(block(i, initialization_vector)));
+    return data;
+}
+
+// CTR-ACPKM: счётчик сквозной, ключ каждой следующей секции — E(D_1) || E(D_2) под ключом предыдущей,
+// D = 80 81 … 9F (старший байт первым)
+template <typename cipher_type>
+static byte_string reference_ctr_acpkm(const block& key_1, const block& key_2, uint64_t initialization_vector, size_t section_size, byte_string data)
+{
+    const block d_1(0x88898A8B8C8D8E8F, 0x8081828384858687), d_2(0x98999A9B9C9D9E9F, 0x9091929394959697);
+    cipher_type cipher(key_1, key_2);
+    for (size_t i = 0; i < number_of_blocks(data); i++)
+    {
+        if (i != 0 && i % (section_size / block::size) == 0)
+            cipher = cipher_type(cipher.encrypt(d_1), cipher.encrypt(d_2));
+        apply_gamma(data, i, cipher.encrypt(block(i, initialization_vector)));
+    }
+    return data;
+}
+
+// Режимы с регистром из chain.size() блоков (ГОСТ Р 34.13-2015, m = n · число блоков): блок i
+// зацепляется с chain[i] — сначала блоками синхропосылки от старшего, затем с результатами
+template <typename cipher_type>
+static byte_string reference_cbc(const cipher_type& cipher, std::vector<block> chain, byte_string data)
+{
+    for (size_t i = 0; i < number_of_blocks(data); i++)
+    {
+        chain.push_back(cipher.encrypt(data_block(data, i) ^ chain[i]));
+        chain.back().store(data.data() + i * block::size);
+    }
+    return data;
+}
+
+template <typename cipher_type>
+static byte_string reference_cfb(const cipher_type& cipher, std::vector<block> chain, byte_string data)
+{
+    for (size_t i = 0; i < number_of_blocks(data); i++)
+    {
+        apply_gamma(data, i, cipher.encrypt(chain[i]));
+        chain.push_back(data_block(data, i));
+    }
+    return data;
+}
+
+template <typename cipher_type>
+static byte_string reference_ofb(const cipher_type& cipher, std::vector<block> chain, byte_string data)
+{
+    for (size_t i = 0; i < number_of_blocks(data); i++)
+    {
+        chain.push_back(cipher.encrypt(chain[i]));
+        apply_gamma(data, i, chain.back());
+    }
+    return data;
+}
+
+// Блок с единственным единичным битом index (0 — младший бит байта 0)
+static block single_bit(int index)
+{
+    return index < 64 ? block(1ULL << index, 0) : block(0, 1ULL << (index - 64));
+}
+
+// Сдвиг на бит влево как 128-битного числа, выдвинутая единица приводится по x^128 + x^7 + x^2 + x + 1
+static block shift_left(const block& b)
+{
+    return block((b.low() << 1) ^ (b.high() >> 63) * 0x87, (b.high() << 1) | (b.low() >> 63));
+}
+
+// Имитовставка: K1 = E(0) << 1, K2 = K1 << 1; неполный последний блок — P* || 1 || 0…0 (ГОСТ Р 34.13-2015, 5.6)
+template <typename cipher_type>
+static block reference_mac(const cipher_type& cipher, const byte_string& data)
+{
+    const block subkey_1 = shift_left(cipher.encrypt(block()));
+    const size_t count = std::max(number_of_blocks(data), (size_t)1);
+    block state;
+    for (size_t i = 0; i + 1 < count; i++)
+        state = cipher.encrypt(state ^ data_block(data, i));
+    const size_t last_length = data.size() - (count - 1) * block::size;
+    if (last_length == block::size)
+        return cipher.encrypt(state ^ data_block(data, count - 1) ^ subkey_1);
+    const block last = (data.empty() ? block() : data_block(data, count - 1, true)) ^ single_bit(8 * (block::size - last_length) - 1);
+    return cipher.encrypt(state ^ last ^ shift_left(subkey_1));
+}
+
+// Умножение в GF(2^128) по модулю x^128 + x^7 + x^2 + x + 1 сдвигами, по биту множителя
+static block multiply_gf128(block a, const block& b)
+{
+    block product;
+    for (int bit = 0; bit < 128; bit++)
+    {
+        if (((bit < 64 ? b.low() >> bit : b.high() >> (bit - 64)) & 1) != 0)
+            product ^= a;
+        a = shift_left(a);
+    }
+    return product;
+}
+
+// MGM (Р 1323565.1.026-2019, RFC 9058): Y_1 = E(0 || ICN), Z_1 = E(1 || ICN), гамма — E(incr_r^i(Y_1)),
+// H_i = E(incr_l^i(Z_1)); имитовставка — E(Σ H_i ⊗ A_i ⊕ Σ H_h+j ⊗ C_j ⊕ H_h+q+1 ⊗ (len(A) || len(C)))
+template <typename cipher_type>
+static block reference_mgm(const cipher_type& cipher, const block& nonce, const byte_string& associated_data, byte_string& data)
+{
+    const block y_1 = cipher.encrypt(block(nonce.low(), nonce.high() & ~(1ULL << 63)));
+    const block z_1 = cipher.encrypt(block(nonce.low(), nonce.high() | (1ULL << 63)));
+    const size_t associated_blocks = number_of_blocks(associated_data), blocks = number_of_blocks(data);
+    auto hash_key = [&](size_t index) { return cipher.encrypt(block(z_1.low(), z_1.high() + index)); };
+    block sum;
+    for (size_t i = 0; i < associated_blocks; i++)
+        sum ^= multiply_gf128(hash_key(i), data_block(associated_data, i, true));
+    for (size_t i = 0; i < blocks; i++)
+    {
+        apply_gamma(data, i, cipher.encrypt(block(y_1.low() + i, y_1.high())), true);
+        sum ^= multiply_gf128(hash_key(associated_blocks + i), data_block(data, i, true));
+    }
+    sum ^= multiply_gf128(hash_key(associated_blocks + blocks), block(data.size() * 8, associated_data.size() * 8));
+    return cipher.encrypt(sum);
+}
+
+// Данные из строки векторов ГОСТ: каждые 16 байт (и неполный остаток) — от старшего байта к младшему
+static byte_string gost_bytes(const char* hexadecimal)
+{
+    byte_string bytes(strlen(hexadecimal) / 2);
+    bool valid = hex_decode(hexadecimal, 2 * bytes.size(), bytes.data());
+    assert(valid && "Wrong test vector");
+    (void)valid;
+    for (size_t i = 0; i < bytes.size(); i += block::size)
+        std::reverse(bytes.begin() + i, bytes.begin() + std::min(bytes.size(), i + block::size));
+    return bytes;
+}
+
+static int verify(uint64_t seed)
+{
+    std::mt19937_64 generator(seed);
+    size_t failures = 0;
+    size_t reported = 0; // Подробности только первых расхождений
+    auto report_mismatch = [&](const std::string& what)
+    {
+        if (reported++ < 20)
+            std::cerr << "Mismatch: " << what << std::endl;
+    };
+    std::printf("{\n  \"isa\": \"%s\",\n  \"seed\": %llu,", simd_isa_name(get_simd_isa()), (unsigned long long)seed);
+
+    // Векторы ГОСТ Р 34.12-2015, приложение А.1
+    std::printf("\n  \"gost\": [");
+    bool first = true;
+    bool gost_conformant = true;
+    auto print_vector = [&](const char* name, const block& result, const char* expected, bool counted)
+    {
+        const bool ok = result == gost_block(expected);
+        std::printf("%s\n    {\"vector\": \"%s\", \"expected\": \"%s\", \"ok\": %s}", first ? "" : ",", name, expected, ok ? "true" : "false");
+        first = false;
+        gost_conformant = gost_conformant && ok;
+        if (!ok && counted)
+        {
+            failures++;
+            report_mismatch(std::string("GOST vector ") + name);
+        }
+    };
+    const char* s_chain[] = {"ffeeddccbbaa99881122334455667700", "b66cd8887d38e8d77765aeea0c9a7efc", "559d8dd7bd06cbfe7e7b262523280d39", "0c3322fed531e4630d80ef5c5a81c50b", "23ae65633f842d29c5df529c13f5acda"};
+    const char* r_chain[] = {"00000000000000000000000000000100", "94000000000000000000000000000001", "a5940000000000000000000000000000", "64a59400000000000000000000000000", "0d64a594000000000000000000000000"};
+    const char* l_chain[] = {"64a59400000000000000000000000000", "d456584dd0e3e84cc3166e4b7fa2890d", "79d26221b87b584cd42fbc4ffea5de9a", "0e93691a0cfc60408b7b68f66b513c13", "e6a8094fee0aa204fd97bcb0b44b8580"};
+    for (int i = 0; i < 4; i++)
+    {
+        print_vector("S", kuznechik_bench::S(gost_block(s_chain[i])), s_chain[i + 1], true);
+        print_vector("S_reversed", kuznechik_bench::S_reversed(gost_block(s_chain[i + 1])), s_chain[i], true);
+    }
+    for (int i = 0; i < 4; i++)
+        print_vector("R", kuznechik_bench::R(gost_block(r_chain[i])), r_chain[i + 1], false);
+    for (int i = 0; i < 4; i++)
+        print_vector("L", kuznechik_bench::L(gost_block(l_chain[i])), l_chain[i + 1], false);
+    const block gost_key_1 = gost_block("8899aabbccddeeff0011223344556677");
+    const block gost_key_2 = gost_block("fedcba98765432100123456789abcdef");
+    print_vector("K10", key_context(gost_key_1, gost_key_2)[9], "72e9dd7416bcf45b755dbaa88e4a4043", false);
+    kuznechik gost_cipher(gost_key_1, gost_key_2);
+    print_vector("encrypt_block", kuznechik_bench::encrypt_block(gost_cipher, gost_block("1122334455667700ffeeddccbbaa9988")), "7f679d90bebc24305a468d42b9d4edcd", false);
+    std::printf("\n  ],\n  \"gost_conformant\": %s,", gost_conformant ? "true" : "false");
+
+    // Эталон стандарта (standard_cipher и эталонные режимы): векторы ГОСТ Р 34.12-2015 (приложение А.1),
+    // ГОСТ Р 34.13-2015 (приложение А, в CBC, CFB и OFB регистр m = 2n), RFC 8645 (CTR-ACPKM, N = 256 бит)
+    // и RFC 9058 (MGM); все входят в код возврата
+    std::printf("\n  \"standard\": [");
+    first = true;
+    auto print_standard = [&](const char* name, bool ok)
+    {
+        std::printf("%s\n    {\"vector\": \"%s\", \"ok\": %s}", first ? "" : ",", name, ok ? "true" : "false");
+        first = false;
+        if (!ok)
+        {
+            failures++;
+            report_mismatch(std::string("standard vector ") + name);
+        }
+    };
+    for (int i = 0; i < 4; i++)
+        print_standard("R", standard_cipher::R(gost_block(r_chain[i])) == gost_block(r_chain[i + 1]));
+    for (int i = 0; i < 4; i++)
+        print_standard("L", standard_cipher::L(gost_block(l_chain[i])) == gost_block(l_chain[i + 1]));
+    const standard_cipher standard(gost_key_1, gost_key_2);
+    const char* standard_keys[] = {"8899aabbccddeeff0011223344556677", "fedcba98765432100123456789abcdef", "db31485315694343228d6aef8cc78c44",
+        "3d4553d8e9cfec6815ebadc40a9ffd04", "57646468c44a5e28d3e59246f429f1ac", "bd079435165c6432b532e82834da581b", "51e640757e8745de705727265a0098b1",
+        "5a7925017b9fdd3ed72a91a22286f984", "bb44e25378c73123a5f32f73cdb6e517", "72e9dd7416bcf45b755dbaa88e4a4043"};
+    for (int i = 0; i < 10; i++)
+        print_standard(("K" + std::to_string(i + 1)).c_str(), standard.iteration_key(i) == gost_block(standard_keys[i]));
+    print_standard("encrypt_block", standard.encrypt(gost_block("1122334455667700ffeeddccbbaa9988")) == gost_block("7f679d90bebc24305a468d42b9d4edcd"));
+    print_standard("decrypt_block", standard.decrypt(gost_block("7f679d90bebc24305a468d42b9d4edcd")) == gost_block("1122334455667700ffeeddccbbaa9988"));
+    const byte_string standard_plain = gost_bytes("1122334455667700ffeeddccbbaa998800112233445566778899aabbcceeff0a"
+        "112233445566778899aabbcceeff0a002233445566778899aabbcceeff0a0011");
+    const std::vector<block> standard_chain = {gost_block("1234567890abcef0a1b2c3d4e5f00112"), gost_block("23344556677889901213141516171819")};
+    print_standard("ecb", reference_ecb(standard, standard_plain) == gost_bytes("7f679d90bebc24305a468d42b9d4edcdb429912c6e0032f9285452d76718d08b"
+        "f0ca33549d247ceef3f5a5313bd4b157d0b09ccde830b9eb3a02c4c5aa8ada98"));
+    print_standard("ctr", reference_ctr(standard, 0x1234567890abcef0, standard_plain) == gost_bytes("f195d8bec10ed1dbd57b5fa240bda1b885eee733f6a13e5df33ce4b33c45dee4"
+        "a5eae88be6356ed3d5e877f13564a3a5cb91fab1f20cbab6d1c6d15820bdba73"));
+    print_standard("ofb", reference_ofb(standard, standard_chain, standard_plain) == gost_bytes("81800a59b1842b24ff1f795e897abd95ed5b47a7048cfab48fb521369d9326bf"
+        "66a257ac3ca0b8b1c80fe7fc10288a13203ebbc066138660a0292243f6903150"));
+    print_standard("cbc", reference_cbc(standard, standard_chain, standard_plain) == gost_bytes("689972d4a085fa4d90e52e3d6d7dcc272826e661b478eca6af1e8e448d5ea5ac"
+        "fe7babf1e91999e85640e8b0f49d90d0167688065a895c631a2d9a1560b63970"));
+    print_standard("cfb", reference_cfb(standard, standard_chain, standard_plain) == gost_bytes("81800a59b1842b24ff1f795e897abd95ed5b47a7048cfab48fb521369d9326bf"
+        "79f2a8eb5cc68d38842d264e97a238b54ffebecd4e922de6c75bd9dd44fbf4d1"));
+    // Имитовставка стандарта — старшие 64 бита (s = 64); неполный блок — первые 40 байт (значение сверено с OMAC GnuTLS)
+    print_standard("mac", reference_mac(standard, standard_plain).high() == 0x336f4d296059fbe3);
+    print_standard("mac_partial_block", reference_mac(standard, gost_bytes("1122334455667700ffeeddccbbaa998800112233445566778899aabbcceeff0a1122334455667788")) ==
+        gost_block("b18d0a7c1d03c530c8eea7c1c14fa927"));
+    print_standard("ctr_acpkm", reference_ctr_acpkm<standard_cipher>(gost_key_1, gost_key_2, 0x1234567890abcef0, 2 * block::size,
+        gost_bytes("1122334455667700ffeeddccbbaa998800112233445566778899aabbcceeff0a112233445566778899aabbcceeff0a00"
+            "2233445566778899aabbcceeff0a001133445566778899aabbcceeff0a001122445566778899aabbcceeff0a00112233"
+            "5566778899aabbcceeff0a0011223344")) ==
+        gost_bytes("f195d8bec10ed1dbd57b5fa240bda1b885eee733f6a13e5df33ce4b33c45dee44bceeb8f646f4c55001706275e85e800"
+            "587c4df568d094393e4834afd0805046cf30f57686aeece11cfc6c316b8a896edffd07ec813636460c4f3b743423163e"
+            "6409a9c282fac8d469d221e7fbd6de5d"));
+    byte_string mgm_data = gost_bytes("1122334455667700ffeeddccbbaa998800112233445566778899aabbcceeff0a112233445566778899aabbcceeff0a00"
+        "2233445566778899aabbcceeff0a0011aabbcc");
+    const block mgm_tag = reference_mgm(standard, gost_block("1122334455667700ffeeddccbbaa9988"),
+        gost_bytes("0202020202020202010101010101010104040404040404040303030303030303ea0505050505050505"), mgm_data);
+    print_standard("mgm", mgm_data == gost_bytes("a9757b8147956e9055b8a33de89f42fc8075d2212bf9fd5bd3f7069aadc16b39497ab15915a6ba85936b5d0ea9f6851c"
+        "c60c14d4d3f883d0ab94420695c76deb2c7552"));
+    print_standard("mgm_tag", mgm_tag == gost_block("cf5d656f40c34f5c46e8bb0e29fcdb4c"));
+    std::printf("\n  ],");
+
+    // Режимы реализации против эталонных режимов над её же блочным шифром (library_cipher): эталонные режимы
+    // сверены с векторами выше, поэтому сходство переносит векторы на логику режимов реализации. Синхропосылка
+    // реализации — регистр из одного блока, неполный блок ECB и CBC дополняется пробелами
+    std::printf("\n  \"standard_modes\": [");
+    first = true;
+    {
+        const block key_1 = random_block(generator);
+        const block key_2 = random_block(generator);
+        const block initialization_vector = random_block(generator);
+        const library_cipher library(key_1, key_2);
+        const size_t sizes[] = {0, 1, 15, 16, 17, 100, kuznechik_bench::group_size * block::size + 33};
+        const size_t acpkm_section_size = 5 * block::size;
+        for (cipher_mode mode : {cipher_mode::ecb, cipher_mode::ctr, cipher_mode::ctr_acpkm, cipher_mode::cbc, cipher_mode::cfb, cipher_mode::ofb})
+        {
+            kuznechik cipher(key_1, key_2);
+            cipher.set_engine(engine_type::reference);
+            cipher.set_mode(mode, initialization_vector);
+            cipher.set_acpkm_section_size(acpkm_section_size);
+            size_t mode_failures = 0;
+            for (size_t size : sizes)
+            {
+                byte_string plain(size);
+                for (unsigned char& c : plain)
+                    c = (unsigned char)generator();
+                byte_string padded(plain);
+                padded.resize(cipher.encrypted_size(size), ' ');
+                byte_string expected;
+                switch (mode)
+                {
+                    case cipher_mode::ecb: expected = reference_ecb(library, padded); break;
+                    case cipher_mode::ctr: expected = reference_ctr(library, initialization_vector.low(), plain); break;
+                    case cipher_mode::ctr_acpkm: expected = reference_ctr_acpkm<library_cipher>(key_1, key_2, initialization_vector.low(), acpkm_section_size, plain); break;
+                    case cipher_mode::cbc: expected = reference_cbc(library, {initialization_vector}, padded); break;
+                    case cipher_mode::cfb: expected = reference_cfb(library, {initialization_vector}, plain); break;
+                    default: expected = reference_ofb(library, {initialization_vector}, plain); break;
+                }
+                byte_string encrypted(cipher.encrypted_size(size));
+                cipher.encrypt(std::as_bytes(std::span(plain)), std::as_writable_bytes(std::span(encrypted)));
+                if (encrypted != expected)
+                {
+                    mode_failures++;
+                    report_mismatch(std::string("standard ") + mode_name(mode) + ", " + std::to_string(size) + " bytes");
+                }
+            }
+            failures += mode_failures;
+            std::printf("%s\n    {\"mode\": \"%s\", \"cases\": %zu, \"failures\": %zu}", first ? "" : ",", mode_name(mode), std::size(sizes), mode_failures);
+            first = false;
+        }
+        // MGM: открытые данные и шифртекст всех длин вокруг границы блока, неполные блоки — в старших байтах
+        kuznechik cipher(key_1, key_2);
+        cipher.set_engine(engine_type::reference);
+        size_t mgm_failures = 0, mgm_cases = 0;
+        for (size_t associated_size : {(size_t)0, (size_t)5, (size_t)16, (size_t)41})
+            for (size_t size : sizes)
+            {
+                mgm_cases++;
+                byte_string associated_data(associated_size), plain(size);
+                for (unsigned char& c : associated_data)
+                    c = (unsigned char)generator();
+                for (unsigned char& c : plain)
+                    c = (unsigned char)generator();
+                byte_string encrypted(size);
+                unsigned char tag[block::size];
+                cipher.mgm_encrypt(initialization_vector, associated_data.data(), associated_size, plain.data(), encrypted.data(), size, tag);
+                const block expected_tag = reference_mgm(library, initialization_vector, associated_data, plain);
+                if (encrypted != plain || !(block(tag) == expected_tag))
+                {
+                    mgm_failures++;
+                    report_mismatch("standard mgm, " + std::to_string(associated_size) + " + " + std::to_string(size) + " bytes");
+                }
+            }
+        failures += mgm_failures;
+        std::printf(",\n    {\"mode\": \"mgm\", \"cases\": %zu, \"failures\": %zu}", mgm_cases, mgm_failures);
+        // Имитовставка: cmac (сообщение двумя кусками) против эталона, неполный последний блок — в старших байтах
+        size_t mac_failures = 0;
+        for (size_t size : sizes)
+        {
+            byte_string data(size);
+            for (unsigned char& c : data)
+                c = (unsigned char)generator();
+            cmac mac(key_1, key_2, engine_type::table);
+            mac.update(data.data(), size / 3);
+            mac.update(data.data() + size / 3, size - size / 3);
+            unsigned char value[block::size];
+            mac.final(value);
+            if (!(block(value) == reference_mac(library, data)))
+            {
+                mac_failures++;
+                report_mismatch("standard mac, " + std::to_string(size) + " bytes");
+            }
+        }
+        failures += mac_failures;
+        std::printf(",\n    {\"mode\": \"mac\", \"cases\": %zu, \"failures\": %zu}", std::size(sizes), mac_failures);
+    }
+    std::printf("\n  ],");
+
+    // Преобразования на случайных блоках
+    std::printf("\n  \"transforms\": [");
+    first = true;
+    const int number_of_transform_checks = 4096;
+    const struct { const char* name; block (*check)(const block&); block (*expected)(const block&); } transform_checks[] =
+    {
+        {"R", kuznechik_bench::R, specified_R},
+        {"S_reversed(S)", [](const block& b) { return kuznechik_bench::S_reversed(kuznechik_bench::S(b)); }, [](const block& b) { return b; }},
+        {"R_reversed(R)", [](const block& b) { return kuznechik_bench::R_reversed(kuznechik_bench::R(b)); }, [](const block& b) { return b; }},
+        {"L_reversed(L)", [](const block& b) { return kuznechik_bench::L_reversed(kuznechik_bench::L(b)); }, [](const block& b) { return b; }}
+    };
+    for (const auto& check : transform_checks)
+    {
+        size_t check_failures = 0;
+        for (int i = 0; i < number_of_transform_checks; i++)
+        {
+            const block b = random_block(generator);
+            check_failures += !(check.check(b) == check.expected(b));
+        }
+        if (check_failures != 0)
+            report_mismatch(std::string("transform ") + check.name);
+        failures += check_failures;
+        std::printf("%s\n    {\"name\": \"%s\", \"cases\": %d, \"failures\": %zu}", first ? "" : ",", check.name, number_of_transform_checks, check_failures);
+        first = false;
+    }
+    std::printf("\n  ],");
+
+    // Пачки блоков: эталон считается один раз на ключ и число блоков, затем сверяется каждый движок на каждом наборе инструкций
+    std::printf("\n  \"blocks\": [");
+    first = true;
+    const simd_isa default_isa = get_simd_isa();
+    const size_t block_counts[] = {1, 2, 3, 7, 8, 15, 16, 17, 31, 63, 64, 65, 127, 128, 129, 500, (size_t)kuznechik_bench::parallel_grain + 3};
+    const int number_of_block_keys = 4;
+    struct block_case { kuznechik cipher; std::vector<block> plain, encrypted; };
+    std::vector<block_case> block_cases;
+    for (int k = 0; k < number_of_block_keys; k++)
+    {
+        const block key_1 = random_block(generator);
+        const block key_2 = random_block(generator);
+        for (size_t count : block_counts)
+        {
+            block_case c{kuznechik(key_1, key_2), {}, {}};
+            for (size_t i = 0; i < count; i++)
+            {
+                c.plain.push_back(random_block(generator));
+                c.encrypted.push_back(kuznechik_bench::encrypt_block(c.cipher, c.plain.back()));
+            }
+            // Эталонное расшифрование тоже сверяется: оно обращает эталонное шифрование
+            for (size_t i = 0; i < count; i++)
+                if (!(kuznechik_bench::decrypt_block(c.cipher, c.encrypted[i]) == c.plain[i]))
+                {
+                    failures++;
+                    report_mismatch("reference decrypt_block");
+                }
+            block_cases.push_back(std::move(c));
+        }
+    }
+    for (simd_isa isa : {simd_isa::generic, simd_isa::sse2, simd_isa::avx2, simd_isa::avx512})
+    {
+        if (!simd_isa_supported(isa))
+            continue;
+        set_simd_isa(isa);
+        for (engine_type engine : {engine_type::table, engine_type::simd, engine_type::bitsliced})
+        {
+            size_t engine_failures = 0;
+            for (block_case& c : block_cases)
+            {
+                c.cipher.set_engine(engine);
+                std::vector<block> blocks = c.plain;
+                c.cipher.encrypt_blocks(blocks.data(), blocks.size());
+                const bool encrypted = blocks == c.encrypted;
+                c.cipher.decrypt_blocks(blocks.data(), blocks.size());
+                const bool decrypted = blocks == c.plain;
+                if (!encrypted || !decrypted)
+                {
+                    engine_failures++;
+                    report_mismatch(std::string(engine_name(engine)) + "/" + simd_isa_name(isa) + (encrypted ? " decrypt_blocks, " : " encrypt_blocks, ") + std::to_string(c.plain.size()) + " blocks");
+                }
+            }
+            failures += engine_failures;
+            std::printf("%s\n    {\"engine\": \"%s\", \"isa\": \"%s\", \"cases\": %zu, \"failures\": %zu}", first ? "" : ",", engine_name(engine), simd_isa_name(isa), block_cases.size(), engine_failures);
+            first = false;
+        }
+    }
+    set_simd_isa(default_isa);
+    size_t table_failures = 0;
+    for (block_case& c : block_cases)
+        for (size_t i = 0; i < c.plain.size(); i++)
+            table_failures += !(kuznechik_bench::decrypt_block_table(c.cipher, c.encrypted[i]) == c.plain[i]);
+    if (table_failures != 0)
+        report_mismatch("table decrypt_block");
+    failures += table_failures;
+    std::printf("%s\n    {\"name\": \"decrypt_block\", \"engine\": \"table\", \"cases\": %zu, \"failures\": %zu}", first ? "" : ",", block_cases.size(), table_failures);
+
+    // Ключи ACPKM: гамма секции 1 — под ключом E(D_1) || E(D_2), посчитанным эталоном по ключу секции 0
+    size_t acpkm_failures = 0;
+    {
+        const size_t section_blocks = 4;
+        kuznechik acpkm_cipher(block_cases[0].cipher);
+        acpkm_cipher.set_engine(engine_type::reference);
+        acpkm_cipher.set_mode(cipher_mode::ctr_acpkm, block(0x1234, 0));
+        acpkm_cipher.set_acpkm_section_size(section_blocks * block::size);
+        std::vector<std::byte> gamma(3 * section_blocks * block::size);
+        acpkm_cipher.encrypt(gamma, gamma);
+        const block constants[2] = {block(0x88898A8B8C8D8E8F, 0x8081828384858687), block(0x98999A9B9C9D9E9F, 0x9091929394959697)};
+        kuznechik section_cipher(acpkm_cipher);
+        for (size_t section = 0; section < 3; section++)
+        {
+            if (section != 0)
+                section_cipher = kuznechik(kuznechik_bench::encrypt_block(section_cipher, constants[0]), kuznechik_bench::encrypt_block(section_cipher, constants[1]));
+            for (size_t i = section * section_blocks; i < (section + 1) * section_blocks; i++)
+            {
+                unsigned char expected[block::size];
+                kuznechik_bench::encrypt_block(section_cipher, block(i, 0x1234)).store(expected);
+                acpkm_failures += memcmp(expected, gamma.data() + i * block::size, block::size) != 0;
+            }
+        }
+    }
+    if (acpkm_failures != 0)
+        report_mismatch("ACPKM section keys");
+    failures += acpkm_failures;
+    std::printf(",\n    {\"name\": \"acpkm_section_keys\", \"engine\": \"reference\", \"cases\": 3, \"failures\": %zu}", acpkm_failures);
+    std::printf("\n  ],");
+
+    // Режимы: эталонный движок против остальных; размеры вокруг границ блока, группы (64 блока) и куска пула (4096 блоков)
+    std::printf("\n  \"modes\": [");
+    first = true;
+    const size_t group_bytes = kuznechik_bench::group_size * block::size;
+    const size_t grain_bytes = kuznechik_bench::parallel_grain * block::size;
+    const size_t sizes[] = {0, 1, 15, 16, 17, 100, group_bytes - 1, group_bytes, group_bytes + 1, 3 * group_bytes + 9, grain_bytes + 33, 3 * grain_bytes + 5};
+    const int max_threads = thread_pool::global().size();
+    // Несколько потоков проверяются и на одном процессоре: разбиение на куски от этого не зависит
+    std::vector<int> thread_counts = {1, 2};
+    if (max_threads > 2)
+        thread_counts.push_back(max_threads);
+    const block key_1 = random_block(generator);
+    const block key_2 = random_block(generator);
+    const block initialization_vector = random_block(generator);
+    const std::byte mgm_associated_data[] = {std::byte{1}, std::byte{2}, std::byte{3}};
+    // Секция ACPKM меньше самых длинных данных и не кратна куску пула: смена ключа внутри групп и кусков
+    const size_t acpkm_section_size = 3 * group_bytes + 5 * block::size;
+    for (cipher_mode mode : {cipher_mode::ecb, cipher_mode::ctr, cipher_mode::ctr_acpkm, cipher_mode::cbc, cipher_mode::cfb, cipher_mode::ofb, cipher_mode::mgm})
+    {
+        kuznechik reference(key_1, key_2);
+        reference.set_engine(engine_type::reference);
+        reference.set_mode(mode, initialization_vector);
+        reference.set_acpkm_section_size(acpkm_section_size);
+        // Открытые данные допустимы только в MGM
+        const std::span<const std::byte> associated_data = mode == cipher_mode::mgm ? std::span<const std::byte>(mgm_associated_data) : std::span<const std::byte>();
+        std::vector<std::vector<std::byte>> plain, encrypted;
+        for (size_t size : sizes)
+        {
+            plain.emplace_back(size);
+            for (std::byte& b : plain.back())
+                b = (std::byte)generator();
+            encrypted.emplace_back(reference.encrypted_size(size));
+            reference.encrypt(plain.back(), encrypted.back(), associated_data);
+        }
+        for (engine_type engine : {engine_type::table, engine_type::simd, engine_type::bitsliced})
+            for (int threads : thread_counts)
+            {
+                thread_pool::configure(threads);
+                kuznechik cipher(key_1, key_2);
+                cipher.set_engine(engine);
+                cipher.set_mode(mode, initialization_vector);
+                cipher.set_acpkm_section_size(acpkm_section_size);
+                size_t mode_failures = 0, cases = 0;
+                for (size_t s = 0; s < plain.size(); s++)
+                    // Сдвиг 0 — выровненный буфер (шифрование на месте окнами), 1 и 7 — через окно на стеке;
+                    // in_place — input и output совпадают
+                    for (size_t shift : {0, 1, 7})
+                        for (bool in_place : {false, true})
+                        {
+                            cases++;
+                            const size_t length = plain[s].size();
+                            const size_t padded_length = cipher.encrypted_size(length);
+                            std::vector<block> storage((padded_length + shift) / block::size + 2);
+                            std::span<std::byte> buffer((std::byte*)storage.data() + shift, padded_length);
+                            std::vector<std::byte> separate_input(plain[s]);
+                            if (in_place)
+                                std::copy(plain[s].begin(), plain[s].end(), buffer.begin());
+                            cipher.encrypt(in_place ? std::span<const std::byte>(buffer.first(length)) : std::span<const std::byte>(separate_input), buffer, associated_data);
+                            bool ok = std::equal(buffer.begin(), buffer.end(), encrypted[s].begin(), encrypted[s].end());
+                            // Расшифрование эталонного шифртекста: исходные данные, в ECB и CBC — с пробелами до целого блока
+                            std::vector<std::byte> separate_output(cipher.decrypted_size(padded_length));
+                            std::copy(encrypted[s].begin(), encrypted[s].end(), buffer.begin());
+                            std::span<std::byte> decrypted = in_place ? buffer.first(separate_output.size()) : std::span<std::byte>(separate_output);
+                            ok = cipher.decrypt(in_place ? std::span<const std::byte>(buffer) : std::span<const std::byte>(encrypted[s]), decrypted, associated_data) && ok;
+                            ok = ok && std::equal(plain[s].begin(), plain[s].end(), decrypted.begin()) &&
+                                std::all_of(decrypted.begin() + length, decrypted.end(), [](std::byte b) { return b == std::byte{' '}; });
+                            if (!ok)
+                            {
+                                mode_failures++;
+                                report_mismatch(std::string(engine_name(engine)) + " " + mode_name(mode) + ", " + std::to_string(threads) + " threads, " + std::to_string(length) +
+                                    " bytes, shift " + std::to_string(shift) + (in_place ? ", in place" : ""));
+                            }
+                        }
+                failures += mode_failures;
+                std::printf("%s\n    {\"engine\": \"%s\", \"mode\": \"%s\", \"threads\": %d, \"cases\": %zu, \"failures\": %zu}", first ? "" : ",", engine_name(engine), mode_name(mode), threads, cases, mode_failures);
+                std::fflush(stdout);
+                first = false;
+            }
+    }
+    thread_pool::configure(max_threads);
+    std::printf("\n  ],");
+
+    // Пакетный CTR (многоключевые ядра): у каждого сообщения свой ключ и синхропосылка, длины вперемешку,
+    // чтобы в одну группу попадали блоки разных сообщений; каждое сообщение сверяется с эталонным ctr_crypt
+    std::printf("\n  \"batch\": [");
+    first = true;
+    const size_t batch_lengths[] = {0, 1, 15, 16, 17, 1000};
+    const int number_of_batch_rounds = 4;
+    std::vector<batch_message> messages;
+    std::vector<std::vector<unsigned char>> batch_plain, batch_expected;
+    for (int round = 0; round < number_of_batch_rounds; round++)
+        for (size_t l = 0; l < std::size(batch_lengths); l++)
+        {
+            const size_t length = batch_lengths[(l + round) % std::size(batch_lengths)];
+            batch_message message{random_block(generator), random_block(generator), generator(), nullptr, nullptr, length};
+            batch_plain.emplace_back(length);
+            for (unsigned char& c : batch_plain.back())
+                c = (unsigned char)generator();
+            batch_expected.emplace_back(length);
+            kuznechik reference(message.key_1, message.key_2);
+            reference.set_engine(engine_type::reference);
+            reference.ctr_crypt(batch_plain.back().data(), batch_expected.back().data(), length, message.initialization_vector);
+            messages.push_back(message);
+        }
+    for (simd_isa isa : {simd_isa::generic, simd_isa::sse2, simd_isa::avx2, simd_isa::avx512})
+    {
+        if (!simd_isa_supported(isa))
+            continue;
+        set_simd_isa(isa);
+        for (engine_type engine : {engine_type::table, engine_type::simd})
+        {
+            std::vector<std::vector<unsigned char>> batch_output;
+            for (size_t m = 0; m < messages.size(); m++)
+            {
+                batch_output.emplace_back(messages[m].length);
+                messages[m].input = batch_plain[m].data();
+                messages[m].output = batch_output[m].data();
+            }
+            kuznechik::ctr_crypt_batch(messages.data(), messages.size(), engine);
+            size_t batch_failures = 0;
+            for (size_t m = 0; m < messages.size(); m++)
+                if (batch_output[m] != batch_expected[m])
+                {
+                    batch_failures++;
+                    report_mismatch(std::string(engine_name(engine)) + "/" + simd_isa_name(isa) + " ctr_crypt_batch, message " + std::to_string(m) + ", " +
+                        std::to_string(messages[m].length) + " bytes");
+                }
+            failures += batch_failures;
+            std::printf("%s\n    {\"engine\": \"%s\", \"isa\": \"%s\", \"messages\": %zu, \"failures\": %zu}", first ? "" : ",", engine_name(engine), simd_isa_name(isa), messages.size(), batch_failures);
+            first = false;
+        }
+    }
+    set_simd_isa(default_isa);
+    std::printf("\n  ],");
+
+    // Ускорение относительно эталона: пачка из одной группы в одном потоке
+    std::printf("\n  \"speedup\": [");
+    first = true;
+    kuznechik cipher(key_1, key_2);
+    const measurement reference_encrypt = measure([&](uint64_t n)
+    {
+        block b = key_1;
+        for (uint64_t i = 0; i < n; i++)
+            b = kuznechik_bench::encrypt_block(cipher, b);
+        sink = b.low();
+    }, 0.05);
+    const measurement reference_decrypt = measure([&](uint64_t n)
+    {
+        block b = key_1;
+        for (uint64_t i = 0; i < n; i++)
+            b = kuznechik_bench::decrypt_block(cipher, b);
+        sink = b.low();
+    }, 0.05);
+    for (engine_type engine : {engine_type::table, engine_type::simd, engine_type::bitsliced})
+    {
+        cipher.set_engine(engine);
+        block blocks[kuznechik_bench::group_size];
+        for (int i = 0; i < kuznechik_bench::group_size; i++)
+            blocks[i] = block(i, 0);
+        const measurement encrypt = measure([&](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; i++)
+                cipher.encrypt_blocks(blocks, kuznechik_bench::group_size);
+            sink = blocks[0].low();
+        }, 0.05);
+        const measurement decrypt = measure([&](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; i++)
+                cipher.decrypt_blocks(blocks, kuznechik_bench::group_size);
+            sink = blocks[0].low();
+        }, 0.05);
+        std::printf("%s\n    {\"engine\": \"%s\", \"encrypt_ns_per_block\": %.2f, \"encrypt_speedup\": %.1f, \"decrypt_ns_per_block\": %.2f, \"decrypt_speedup\": %.1f}",
+            first ? "" : ",", engine_name(engine), encrypt.seconds * 1e9 / kuznechik_bench::group_size, reference_encrypt.seconds * kuznechik_bench::group_size / encrypt.seconds,
+            decrypt.seconds * 1e9 / kuznechik_bench::group_size, reference_decrypt.seconds * kuznechik_bench::group_size / decrypt.seconds);
+        first = false;
+    }
+    std::printf("\n  ],\n  \"failures\": %zu\n}\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    engine_type engine = engine_type::simd;
+    size_t max_size = (size_t)256 << 20;
+    double time_limit = 2;
+    bool verification = false;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--engine=reference")
+            engine = engine_type::reference;
+        else if (option == "--engine=table")
+            engine = engine_type::table;
+        else if (option == "--engine=simd")
+            engine = engine_type::simd;
+        else if (option == "--engine=bitsliced")
+            engine = engine_type::bitsliced;
+        else if (option.rfind("--max-size=", 0) == 0)
+            max_size = std::stoull(option.substr(11));
+        else if (option.rfind("--time-limit=", 0) == 0)
+            time_limit = std::stod(option.substr(13));
+        else if (option == "--verify")
+            verification = true;
+        else if (option.rfind("--seed=", 0) == 0)
+            seed = std::stoull(option.substr(7));
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--engine=table|simd|bitsliced|reference] [--max-size=<bytes>] [--time-limit=<seconds>]" << std::endl;
+            std::cerr << "       " << argv[0] << " --verify [--seed=<n>]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (verification)
+        return verify(seed);
+
+    const block key_1("aaadefgpqrstuvws");
+    const block key_2("bBbbbbebbeaaaaas");
+    const int max_threads = thread_pool::global().size();
+
+    std::printf("{\n  \"isa\": \"%s\",\n  \"max_threads\": %d,\n  \"cycle_counter\": \"%s\",", simd_isa_name(get_simd_isa()), max_threads,
+#ifdef KUZNECHIK_BENCH_TSC
+        "tsc"
+#else
+        "none"
+#endif
+    );
+
+    // Отдельные преобразования: каждое применяется к результату предыдущего (задержка, а не пропускная способность)
+    std::printf("\n  \"primitives\": [");
+    bool first = true;
+    print_operation(first, "GF_mul", nullptr, measure([](uint64_t n)
+    {
+        unsigned char a = 0x57;
+        for (uint64_t i = 0; i < n; i++)
+            a = kuznechik_bench::GF_mul(a, (unsigned char)(i | 1));
+        sink = a;
+    }), 0);
+    const struct { const char* name; block (*transform)(const block&); } transforms[] =
+    {
+        {"S", kuznechik_bench::S}, {"R", kuznechik_bench::R}, {"L", kuznechik_bench::L}, {"L_reversed", kuznechik_bench::L_reversed}
+    };
+    for (const auto& transform : transforms)
+        print_operation(first, transform.name, nullptr, measure([&](uint64_t n)
+        {
+            block b = key_1;
+            for (uint64_t i = 0; i < n; i++)
+                b = transform.transform(b);
+            sink = b.low();
+        }), block::size);
+    // Сумма произведений в GF(2^128) для имитовставки MGM: группа из 64 слагаемых с одним приведением
+    block factors[bitslice_circuit::batch_size];
+    for (int i = 0; i < bitslice_circuit::batch_size; i++)
+        factors[i] = block(0x0123456789abcdef * (i + 1), i);
+    print_operation(first, "gf128_multiply_sum", "generic", measure([&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; i++)
+            factors[0] = gf128_multiply_sum_generic(factors, factors + 1, bitslice_circuit::batch_size - 1);
+        sink = factors[0].low();
+    }), block::size * (bitslice_circuit::batch_size - 1));
+    if (gf128_clmul_supported())
+        print_operation(first, "gf128_multiply_sum", "pclmul", measure([&](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; i++)
+                factors[0] = gf128_multiply_sum(factors, factors + 1, bitslice_circuit::batch_size - 1);
+            sink = factors[0].low();
+        }), block::size * (bitslice_circuit::batch_size - 1));
+    // Hex-кодек для hex-файлов: кусок hex_chunk_size символов
+    std::vector<unsigned char> hex_bytes(hex_chunk_size / 2, 0xa5);
+    std::vector<char> hex_characters(hex_chunk_size);
+    const struct { const char* name; void (*encode)(const unsigned char*, size_t, char*); bool (*decode)(const char*, size_t, unsigned char*); } hex_codecs[] =
+    {
+        {"generic", hex_encode_generic, hex_decode_generic}, {"simd", hex_encode, hex_decode}
+    };
+    for (const auto& codec : hex_codecs)
+    {
+        print_operation(first, "hex_encode", codec.name, measure([&](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; i++)
+                codec.encode(hex_bytes.data(), hex_bytes.size(), hex_characters.data());
+            sink = hex_characters[0];
+        }), hex_bytes.size());
+        print_operation(first, "hex_decode", codec.name, measure([&](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; i++)
+                sink = codec.decode(hex_characters.data(), hex_characters.size(), hex_bytes.data());
+        }), hex_bytes.size());
+    }
+    print_operation(first, "key_schedule", nullptr, measure([&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            key_context context(key_1, block(i, 0));
+            sink = context[9].low();
+        }
+    }), 0);
+    std::printf("\n  ],");
+
+    // Шифрование блоков: одиночный блок эталонно и по таблицам, пачки — каждым движком
+    std::printf("\n  \"blocks\": [");
+    first = true;
+    kuznechik cipher(key_1, key_2);
+    print_operation(first, "encrypt_block", "reference", measure([&](uint64_t n)
+    {
+        block b = key_1;
+        for (uint64_t i = 0; i < n; i++)
+            b = kuznechik_bench::encrypt_block(cipher, b);
+        sink = b.low();
+    }), block::size);
+    print_operation(first, "decrypt_block", "reference", measure([&](uint64_t n)
+    {
+        block b = key_1;
+        for (uint64_t i = 0; i < n; i++)
+            b = kuznechik_bench::decrypt_block(cipher, b);
+        sink = b.low();
+    }), block::size);
+    print_operation(first, "decrypt_block", "table", measure([&](uint64_t n)
+    {
+        block b = key_1;
+        for (uint64_t i = 0; i < n; i++)
+            b = kuznechik_bench::decrypt_block_table(cipher, b);
+        sink = b.low();
+    }), block::size);
+    for (engine_type batch_engine : {engine_type::table, engine_type::simd, engine_type::bitsliced})
+    {
+        // Одна группа независимых блоков в одном потоке
+        cipher.set_engine(batch_engine);
+        block blocks[bitslice_circuit::batch_size];
+        for (int i = 0; i < bitslice_circuit::batch_size; i++)
+            blocks[i] = block(i, 0);
+        cipher.encrypt_blocks(blocks, bitslice_circuit::batch_size); // Построение схем до замера
+        print_operation(first, "encrypt_blocks", engine_name(batch_engine), measure([&](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; i++)
+                cipher.encrypt_blocks(blocks, bitslice_circuit::batch_size);
+            sink = blocks[0].low();
+        }), block::size * bitslice_circuit::batch_size);
+        cipher.decrypt_blocks(blocks, bitslice_circuit::batch_size);
+        print_operation(first, "decrypt_blocks", engine_name(batch_engine), measure([&](uint64_t n)
+        {
+            for (uint64_t i = 0; i < n; i++)
+                cipher.decrypt_blocks(blocks, bitslice_circuit::batch_size);
+            sink = blocks[0].low();
+        }), block::size * bitslice_circuit::batch_size);
+    }
+    // Имитовставка: одна цепочка (задержка блока) и 64 независимые цепочки одним вызовом update_batch
+    std::vector<unsigned char> mac_data((size_t)bitslice_circuit::batch_size * 1024 * block::size, 0x5a);
+    const size_t stream_length = mac_data.size() / bitslice_circuit::batch_size;
+    cmac single_mac(key_1, key_2, engine);
+    print_operation(first, "cmac_update", engine_name(engine), measure([&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; i++)
+            single_mac.update(mac_data.data(), stream_length);
+        sink = mac_data[0];
+    }), stream_length);
+    std::vector<cmac> macs;
+    std::vector<cmac*> mac_contexts;
+    std::vector<const unsigned char*> mac_streams;
+    std::vector<size_t> mac_lengths(bitslice_circuit::batch_size, stream_length);
+    macs.reserve(bitslice_circuit::batch_size);
+    for (int i = 0; i < bitslice_circuit::batch_size; i++)
+    {
+        macs.emplace_back(key_1, block(i, 0), engine);
+        mac_contexts.push_back(&macs.back());
+        mac_streams.push_back(mac_data.data() + i * stream_length);
+    }
+    print_operation(first, "cmac_update_batch", engine_name(engine), measure([&](uint64_t n)
+    {
+        for (uint64_t i = 0; i < n; i++)
+            cmac::update_batch(mac_contexts.data(), mac_streams.data(), mac_lengths.data(), mac_contexts.size());
+        sink = mac_data[0];
+    }), mac_data.size());
+    std::printf("\n  ],");
+
+    // Сквозное шифрование в памяти: режимы × направления × число потоков × размеры
+    // Размеры растут в 16 раз; серия обрывается, когда прогон дольше time_limit
+    std::printf("\n  \"end_to_end\": [");
+    first = true;
+    cipher.set_engine(engine);
+    std::vector<block> data;
+    std::vector<unsigned char> output; // MGM: шифртекст в отдельном буфере, данные не меняются между прогонами
+    unsigned char tag[block::size];
+    for (cipher_mode mode : {cipher_mode::ecb, cipher_mode::ctr, cipher_mode::ctr_acpkm, cipher_mode::cbc, cipher_mode::cfb, cipher_mode::ofb, cipher_mode::mgm})
+        for (bool decrypt : {false, true})
+            for (int threads = 1; threads <= max_threads; threads = threads < max_threads && threads * 2 > max_threads ? max_threads : threads * 2)
+            {
+                thread_pool::configure(threads);
+                cipher.set_mode(mode, block(0x1234, 0x5678));
+                for (size_t size = block::size; size <= max_size; size *= 16)
+                {
+                    const size_t count = size / block::size;
+                    data.assign(count, key_2);
+                    const unsigned char* bytes = (const unsigned char*)data.data();
+                    output.resize(size);
+                    if (mode == cipher_mode::mgm)
+                        cipher.mgm_encrypt(key_1, nullptr, 0, bytes, output.data(), size, tag); // Верная имитовставка для расшифрования
+                    measurement result = measure([&](uint64_t n)
+                    {
+                        for (uint64_t i = 0; i < n; i++)
+                        {
+                            if (mode == cipher_mode::mgm && decrypt)
+                                sink = cipher.mgm_decrypt(key_1, nullptr, 0, output.data(), (unsigned char*)data.data(), size, tag);
+                            else if (mode == cipher_mode::mgm)
+                                cipher.mgm_encrypt(key_1, nullptr, 0, bytes, output.data(), size, tag);
+                            else if (decrypt)
+                                kuznechik_bench::decrypt_chunk(cipher, data.data(), count);
+                            else
+                                kuznechik_bench::encrypt_chunk(cipher, data.data(), count);
+                        }
+                        sink = data[0].low();
+                    }, std::min(0.2, time_limit));
+                    std::printf("%s\n    {\"engine\": \"%s\", \"mode\": \"%s\", \"direction\": \"%s\", \"threads\": %d, \"bytes\": %zu, \"ns_per_op\": %.1f",
+                        first ? "" : ",", engine_name(engine), mode_name(mode), decrypt ? "decrypt" : "encrypt", threads, size, result.seconds * 1e9);
+#ifdef KUZNECHIK_BENCH_TSC
+                    std::printf(", \"cycles_per_byte\": %.3f", result.cycles / size);
+#endif
+                    std::printf(", \"gb_per_s\": %.4f}", size / result.seconds / 1e9);
+                    std::fflush(stdout);
+                    first = false;
+                    if (result.seconds > time_limit)
+                        break;
+                }
+                if (threads == max_threads)
+                    break;
+            }
+    std::printf("\n  ]\n}\n");
+    return 0;
+}
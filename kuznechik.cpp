@@ -1,443 +1,490 @@
 #include "kuznechik.h"
+#include "kuznechik_dispatch.h"
+
+// Время развёртывания ключа (конструктор kuznechik) добавляется к статистике операции
+static cipher_stats add_key_time(cipher_stats stats, double key_time)
+{
+    stats.key_time += key_time;
+    stats.total_time += key_time;
+    return stats;
+}
 
 // Функция шифрования файла с использованием двух 16-байтовых ключей
-void encrypt_file(const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2)
+cipher_stats encrypt_file(const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine, cipher_mode mode, const block& initialization_vector)
 {
     // Создаём объект класса kuznechik для шифрования
-    // - input_file_name: путь к входному файлу, который нужно зашифровать
     // - block(key_1): первый 16-байтовый ключ, преобразованный в объект типа block
     // - block(key_2): второй 16-байтовый ключ, преобразованный в объект типа block
-    // В конструкторе происходит:
-    // 1. Чтение данных из файла в буфер
-    // 2. Генерация итерационных ключей на основе key_1 и key_2
-    kuznechik encryptor(input_file_name, block(key_1), block(key_2));
+    // В конструкторе генерируются итерационные ключи на основе key_1 и key_2
+    double start = omp_get_wtime();
+    kuznechik encryptor{block(key_1), block(key_2)};
+    double key_time = omp_get_wtime() - start;
+    encryptor.set_engine(engine); // Табличный или эталонный способ шифрования
+    encryptor.set_mode(mode, initialization_vector); // Режим шифрования и синхропосылка
     
-    // Вызываем метод encrypt_data для шифрования данных
+    // Вызываем метод encrypt_stream для шифрования файла
+    // - input_file_name: путь к входному файлу, который нужно зашифровать
     // - output_file_name: путь к файлу, куда будет сохранён зашифрованный результат
-    // Метод encrypt_data:
-    // 1. Применяет алгоритм шифрования "Кузнечик" к каждому блоку данных (SP-сеть)
-    // 2. Записывает зашифрованные данные в выходной файл
-    encryptor.encrypt_data(output_file_name);
+    // Метод encrypt_stream:
+    // 1. Читает файл кусками фиксированного размера, не загружая его целиком
+    // 2. Шифрует очередной кусок, пока следующий читается, а предыдущий записывается
+    return add_key_time(encryptor.encrypt_stream(input_file_name, output_file_name), key_time);
 }
 
 // Перегруженная функция шифрования файла с использованием ключа в шестнадцатеричном формате
-void encrypt_file(const char* input_file_name, const char* output_file_name, const char* hexadecimal_key)
+cipher_stats encrypt_file(const char* input_file_name, const char* output_file_name, const char* hexadecimal_key, engine_type engine, cipher_mode mode, const block& initialization_vector)
 {
     // Создаём объект класса kuznechik для шифрования
-    // - input_file_name: путь к входному файлу
     // - hexadecimal_key: строка из 64 символов (32 байта в шестнадцатеричном формате)
     // В конструкторе происходит:
-    // 1. Чтение данных из файла
-    // 2. Преобразование hex-ключа в два 16-байтовых ключа
-    // 3. Генерация итерационных ключей
-    kuznechik encryptor(input_file_name, hexadecimal_key);
+    // 1. Преобразование hex-ключа в два 16-байтовых ключа
+    // 2. Генерация итерационных ключей
+    double start = omp_get_wtime();
+    kuznechik encryptor(hexadecimal_key);
+    double key_time = omp_get_wtime() - start;
+    encryptor.set_engine(engine);
+    encryptor.set_mode(mode, initialization_vector);
     
-    // Вызываем метод encrypt_data для шифрования данных
+    // Вызываем метод encrypt_stream для шифрования файла
+    // - input_file_name: путь к входному файлу, содержимое интерпретируется как hex (true)
     // - output_file_name: путь к файлу для записи зашифрованных данных
-    // Метод выполняет шифрование и сохраняет результат
-    encryptor.encrypt_data(output_file_name);
+    return add_key_time(encryptor.encrypt_stream(input_file_name, output_file_name, true), key_time);
 }
 
-void decrypt_file( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2)
+cipher_stats decrypt_file( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine, cipher_mode mode, const block& initialization_vector)
 {
-    kuznechik encryptor( input_file_name, block( key_1), block( key_2));
-    encryptor.decrypt_data( output_file_name);
+    double start = omp_get_wtime();
+    kuznechik encryptor{ block( key_1), block( key_2)};
+    double key_time = omp_get_wtime() - start;
+    encryptor.set_engine( engine);
+    encryptor.set_mode( mode, initialization_vector);
+    return add_key_time( encryptor.decrypt_stream( input_file_name, output_file_name), key_time);
 }
 
-void decrypt_file( const char* input_file_name, const char* output_file_name, const char* hexadecimal_key)
+cipher_stats decrypt_file( const char* input_file_name, const char* output_file_name, const char* hexadecimal_key, engine_type engine, cipher_mode mode, const block& initialization_vector)
 {
-    kuznechik encryptor( input_file_name, hexadecimal_key);
-    encryptor.decrypt_data( output_file_name);
+    double start = omp_get_wtime();
+    kuznechik encryptor( hexadecimal_key);
+    double key_time = omp_get_wtime() - start;
+    encryptor.set_engine( engine);
+    encryptor.set_mode( mode, initialization_vector);
+    return add_key_time( encryptor.decrypt_stream( input_file_name, output_file_name, true), key_time);
+}
+
+cipher_stats encrypt_file_mapped( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine, cipher_mode mode, const block& initialization_vector)
+{
+    double start = omp_get_wtime();
+    kuznechik encryptor{ block( key_1), block( key_2)};
+    double key_time = omp_get_wtime() - start;
+    encryptor.set_engine( engine);
+    encryptor.set_mode( mode, initialization_vector);
+    return add_key_time( encryptor.encrypt_mapped( input_file_name, output_file_name), key_time);
+}
+
+cipher_stats decrypt_file_mapped( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine, cipher_mode mode, const block& initialization_vector)
+{
+    double start = omp_get_wtime();
+    kuznechik encryptor{ block( key_1), block( key_2)};
+    double key_time = omp_get_wtime() - start;
+    encryptor.set_engine( engine);
+    encryptor.set_mode( mode, initialization_vector);
+    return add_key_time( encryptor.decrypt_mapped( input_file_name, output_file_name), key_time);
 }
 
 // Функция преобразует строку в шестнадцатеричном формате в обычную строку байтов
 std::string hex_to_string(const std::string input_string)
 {
-    // Создаём пустую строку для хранения результата
-    std::string output_string;
-
-    // Проходим по входной строке с шагом 2, так как каждая пара символов представляет один байт
-    for (int i = 0; i < input_string.length(); i += 2)
-    {
-        // Находим позицию первого символа пары в таблице hex_symbol_table (0–f)
-        // hex_symbol_table — это массив символов "0123456789abcdef" (предполагается, определён где-то в коде)
-        const char* p = std::lower_bound(hex_symbol_table, hex_symbol_table + 16, input_string[i]);
-        
-        // Находим позицию второго символа пары в той же таблице
-        const char* q = std::lower_bound(hex_symbol_table, hex_symbol_table + 16, input_string[i + 1]);
-        
-        // Преобразуем два символа в один байт:
-        // - (p - hex_symbol_table) даёт значение первого символа (0–15)
-        // - Сдвиг влево на 4 бита (<< 4) помещает его в старший полубайт
-        // - (q - hex_symbol_table) даёт значение второго символа (0–15), добавляется в младший полубайт
-        // - Операция | объединяет их в один байт
-        output_string.push_back(((p - hex_symbol_table) << 4) | (q - hex_symbol_table));
-    }
-    
-    // Возвращаем строку байтов
+    // Каждая пара символов — один байт; декодирование сразу в строку результата
+    std::string output_string(input_string.length() / 2, '\0');
+    bool valid = hex_decode(input_string.data(), input_string.length(), (unsigned char*)&output_string[0]);
+    assert(valid && "Wrong hexadecimal string");
     return output_string;
 }
 
 // Функция преобразует обычную строку байтов в строку в шестнадцатеричном формате
 std::string string_to_hex(const std::string input_string)
 {
-    // Создаём пустую строку для хранения результата
-    std::string output_string;
-    
-    // Проходим по каждому символу входной строки
-    for (int i = 0; i < input_string.length(); i++)
-    {
-        // Преобразуем каждый байт в два шестнадцатеричных символа с помощью вспомогательной функции
-        // и добавляем их к результирующей строке
-        output_string += char_to_hex_string(input_string[i]);
-    }
-    
-    // Возвращаем строку в hex-формате
+    std::string output_string(2 * input_string.length(), '\0');
+    hex_encode((const unsigned char*)input_string.data(), input_string.length(), &output_string[0]);
     return output_string;
 }
 
-// Функция преобразует один байт в строку из двух шестнадцатеричных символов
+// Функция преобразует один байт в строку из двух шестнадцатеричных символов (например, 0x4f → "4f")
 std::string char_to_hex_string(char c)
 {
-    // Определяем строку с символами для шестнадцатеричного представления
-    std::string hex = "0123456789abcdef";
-    
-    // Создаём пустую строку для результата
-    std::string hex_str;
-    
-    // Вычисляем старший полубайт (4 старших бита):
-    // - int(c) / 16 даёт значение от 0 до 15
-    // - hex[...] выбирает соответствующий символ (например, 10 → 'a')
-    hex_str += hex[int(int(c) / 16)];
-    
-    // Вычисляем младший полубайт (4 младших бита):
-    // - int(c) % 16 даёт остаток от 0 до 15
-    // - hex[...] выбирает соответствующий символ
-    hex_str += hex[int(c) % 16];
-    
-    // Возвращаем строку из двух символов (например, 0x4f → "4f")
+    std::string hex_str(2, '\0');
+    hex_encode((const unsigned char*)&c, 1, &hex_str[0]);
     return hex_str;
 }
 
 // Функция шифрования данных, содержащихся в объекте kuznechik, и записи результата в файл
-void kuznechik::encrypt_data(const char* output_file_name, bool use_hex)
+cipher_stats kuznechik::encrypt_data(const char* output_file_name, bool use_hex)
 {
-    // Объявляем переменные для замера времени выполнения
-    double start;
-    double end;
-    
+    // Статистика начинается с чтения файла в конструкторе
+    cipher_stats stats = load_stats;
+    stats_scope scope(stats);
+
     // Записываем время начала шифрования с использованием OpenMP
     // omp_get_wtime() возвращает текущее время в секундах с высокой точностью
-    start = omp_get_wtime();
+    double start = omp_get_wtime();
+    std::vector<uint64_t> items = thread_pool::global().processed_items();
     
-    // Параллельная секция OpenMP для ускорения шифрования на многоядерных процессорах
-    #pragma omp parallel
-    {
-        // Директива указывает, что цикл будет распределён между потоками
-        #pragma omp for
-        // Проходим по всем блокам данных, хранящимся в векторе data
-        for (int i = 0; i < data.size(); i++)
-        {
-            // Шифруем каждый блок данных с помощью метода encrypt_block
-            // encrypt_block реализует SP-сеть "Кузнечика" (9 раундов S-L + финальный XOR)
-            // Результат записываем обратно в тот же элемент вектора
-            data[i] = encrypt_block(data[i]);
-        }
-    }
-    
-    // Записываем время окончания шифрования
-    end = omp_get_wtime();
+    // Весь буфер шифруется как один кусок потока, начиная с первого блока
+    block chaining_block = initialization_vector;
+    acpkm_chain acpkm;
+    encrypt_chunk(data.data(), data.size(), 0, chaining_block, acpkm);
     
-    // Выводим время выполнения шифрования в секундах
-    std::cout << "Encryption time: " << end - start << "s" << std::endl;
+    // Время шифрования и блоки, обработанные каждым потоком
+    stats.cipher_time += omp_get_wtime() - start;
+    stats.add_thread_blocks(items);
     
     // Записываем зашифрованные данные в файл
     // - output_file_name: путь к выходному файлу
     // - use_hex: флаг, указывающий, записывать ли данные в шестнадцатеричном формате
     // Метод write_to_file преобразует блоки в строку и сохраняет их
-    write_to_file(output_file_name, use_hex);
+    write_to_file(output_file_name, use_hex, stats);
+    scope.finish();
+    return stats;
 }
 
-void kuznechik::decrypt_data( const char* output_file_name, bool use_hex)
+cipher_stats kuznechik::decrypt_data( const char* output_file_name, bool use_hex)
 {
-//    omp_set_num_threads(OMP_NUM_THREADS);
-    double start;
-    double end;
-    start = omp_get_wtime();
-    #pragma omp parallel
-    {
-        #pragma omp for
-        for ( int i = 0; i < data.size(); i++)
-            data[i] = decrypt_block( data[i]);
-    }
-    end = omp_get_wtime();
-    std::cout << "Decryption time: "  << end - start << "s" << std::endl;
-    write_to_file( output_file_name, use_hex);
+    cipher_stats stats = load_stats;
+    stats_scope scope( stats);
+    double start = omp_get_wtime();
+    std::vector<uint64_t> items = thread_pool::global().processed_items();
+    block chaining_block = initialization_vector;
+    acpkm_chain acpkm;
+    decrypt_chunk( data.data(), data.size(), 0, chaining_block, acpkm);
+    stats.cipher_time += omp_get_wtime() - start;
+    stats.add_thread_blocks( items);
+    write_to_file( output_file_name, use_hex, stats);
+    scope.finish();
+    return stats;
+}
+
+// Конструктор класса kuznechik с уже развёрнутым ключом
+kuznechik::kuznechik(std::shared_ptr<const key_context> key) : key(std::move(key))
+{
+    assert(this->key && "Wrong key");
 }
 
 // Конструктор класса kuznechik с двумя 16-байтовыми ключами
-kuznechik::kuznechik(const char* file_name, const block key_1, const block key_2)
+// Итерационные ключи берутся из общего кэша: под уже встречавшимся ключом
+// сеть Фейстеля (32 итерации F) не пересчитывается
+kuznechik::kuznechik(const block& key_1, const block& key_2) : kuznechik(key_cache::global().get(key_1, key_2))
+{
+}
+
+// Конструктор класса kuznechik с ключом в шестнадцатеричном формате
+// Ключ из 64 hex-символов делится на два 16-байтовых (см. split_hexadecimal_key)
+kuznechik::kuznechik(const char* hexadecimal_key) : kuznechik(key_cache::global().get(hexadecimal_key))
+{
+}
+
+// Конструктор с двумя ключами, сразу читающий весь файл в буфер
+kuznechik::kuznechik(const char* file_name, const block& key_1, const block& key_2) : kuznechik(key_1, key_2)
 {
-    // Инициализируем вектор итерационных ключей нужным размером
-    // number_of_iteration_keys = 10 (по стандарту "Кузнечика" нужно 10 ключей для 10 раундов)
-    iteration_keys.resize(number_of_iteration_keys);
-    
     // Читаем данные из файла в буфер (вектор data)
     // - file_name: путь к входному файлу
     // - Данные разбиваются на блоки по 16 байт (128 бит), как требует алгоритм
     read_file_to_data_buffer(file_name);
-    
-    // Вычисляем итерационные константы для сети Фейстеля
-    // - Создаются 32 константы, используемые при генерации ключей
-    calculate_iteration_constants();
-    
-    // Генерируем 10 итерационных ключей на основе двух входных ключей
-    // - key_1: первый 16-байтовый ключ
-    // - key_2: второй 16-байтовый ключ
-    // - Используется сеть Фейстеля для развертывания ключей
-    generate_iteraion_keys(key_1, key_2);
 }
 
-// Конструктор класса kuznechik с ключом в шестнадцатеричном формате
-kuznechik::kuznechik(const char* file_name, const char* hexadecimal_key)
+// Конструктор с hex-ключом, сразу читающий весь файл в буфер
+kuznechik::kuznechik(const char* file_name, const char* hexadecimal_key) : kuznechik(hexadecimal_key)
 {
-    // Проверяем, что длина hex-ключа равна 64 символам (32 байта = 256 бит)
-    // Если длина неверная, программа завершится с ошибкой "Wrong key"
-    assert(strlen(hexadecimal_key) == 64 && "Wrong key");
-    
-    // Инициализируем вектор итерационных ключей (10 ключей по 128 бит)
-    iteration_keys.resize(number_of_iteration_keys);
-    
     // Читаем данные из файла, интерпретируя их как шестнадцатеричные
     // - file_name: путь к файлу
     // - true: флаг указывает, что содержимое файла в hex-формате
     read_file_to_data_buffer(file_name, true);
-    
-    // Вычисляем итерационные константы для сети Фейстеля
-    calculate_iteration_constants();
-    
-    // Преобразуем hex-ключ (64 символа) в строку байтов (32 байта)
-    // Например, "8899aabb..." → строка из 32 байт
-    std::string ascii_key_pair = hex_to_string(hexadecimal_key);
-    
-    // Генерируем итерационные ключи, разделяя полученную строку на два ключа:
-    // - Первый ключ: первые 16 байт (0–15)
-    // - Второй ключ: следующие 16 байт (16–31)
-    // Исправление: substr(0, 16) вместо (0, 15), так как нужно 16 байт
-    generate_iteraion_keys(ascii_key_pair.substr(0, 16), ascii_key_pair.substr(16));
 }
+
 // Чтение файла в буфер данных
 void kuznechik::read_file_to_data_buffer(const char* file_name, bool is_hex)
 {
+    double start = omp_get_wtime();
     std::ifstream input_file_stream(file_name); // Открываем файл
     assert(input_file_stream && "Can't find file"); // Проверяем успешность открытия
     std::string file_content((std::istreambuf_iterator<char>(input_file_stream)), std::istreambuf_iterator<char>()); // Читаем всё содержимое в строку
+    load_stats.read_time = omp_get_wtime() - start;
 
     if (is_hex == true) // Если данные в hex-формате
-        file_content = hex_to_string(file_content); // Преобразуем hex в байты
+    {
+        double hex_start = omp_get_wtime();
+        // Декодируем на месте (байты пишутся не дальше прочитанных символов); перевод строки в конце файла допускается
+        size_t hexadecimal_length = file_content.find_last_not_of(" \t\r\n") + 1;
+        bool valid = hex_decode(file_content.data(), hexadecimal_length, (unsigned char*)&file_content[0]);
+        assert(valid && "Wrong hexadecimal file");
+        file_content.resize(hexadecimal_length / 2);
+        load_stats.hex_time = omp_get_wtime() - hex_start;
+    }
+    data_length = file_content.length(); // Запоминаем длину до дополнения
+    load_stats.bytes = data_length;
+    load_stats.files = 1;
 
     int length_of_the_trailing_string = file_content.length() % block::size; // Вычисляем длину остатка
 
-    // Разбиваем содержимое на блоки по 16 байт
+    // Разбиваем содержимое на блоки по 16 байт прямо из строки, без промежуточных копий
+    data.reserve(file_content.length() / block::size + 1);
+    const unsigned char* content_bytes = (const unsigned char*)file_content.data();
     for (int i = 0; i + block::size <= file_content.length(); i += block::size)
-        data.push_back(block(file_content.substr(i, block::size)));
+        data.push_back(block(content_bytes + i));
 
     // Обрабатываем остаток, дополняя пробелами
     if (length_of_the_trailing_string != 0)
     {
-        std::string trailing_content = file_content.substr(file_content.length() - length_of_the_trailing_string);
-        for (int i = 0; i < block::size - length_of_the_trailing_string; i++)
-            trailing_content.push_back(' ');
+        unsigned char trailing_content[block::size];
+        memset(trailing_content, ' ', block::size);
+        memcpy(trailing_content, content_bytes + file_content.length() - length_of_the_trailing_string, length_of_the_trailing_string);
         data.push_back(block(trailing_content));
     }
+    load_stats.total_time = omp_get_wtime() - start;
 }
 
+// Получение итерационной константы по индексу
+const block& kuznechik::get_iteration_constant(int index)
+{
+    assert(index >= 0 && index < number_of_iteration_constants && "Wrong index value"); // Проверка (до 32)
+    return iteration_constants[index]; // Возвращаем константу
+}
+
+// Получение итерационного ключа по индексу
+const block& kuznechik::get_iteration_key(int index) const
+{
+    assert(index >= 0 && index < number_of_iteration_keys && "Wrong index value"); // Проверка (до 10)
+    return (*key)[index]; // Возвращаем ключ
+}
+
+
 // Вычисление итерационных констант для сети Фейстеля
-void kuznechik::calculate_iteration_constants()
+constexpr constexpr_array<block, kuznechik::number_of_iteration_constants> kuznechik::calculate_iteration_constants()
+{
+    // Первый байт — номер итерации, остальные — символы '0' (0x30)
+    const uint64_t zero_characters = 0x3030303030303030ULL;
+    constexpr_array<block, number_of_iteration_constants> constants = {};
+    for (int i = 0; i < number_of_iteration_constants; i++) // Создаём 32 константы
+        constants.values[i] = L(block((zero_characters << 8) | (uint64_t)i, zero_characters)); // Применяем L-преобразование
+    return constants;
+}
+
+constexpr constexpr_array<block, kuznechik::number_of_iteration_constants> kuznechik::iteration_constants = calculate_iteration_constants();
+
+// Генерация итерационных ключей (сеть Фейстеля)
+void kuznechik::generate_iteraion_keys(const block& key_1, const block& key_2, block iteration_keys[])
+{
+    iteration_keys[0] = key_1; // Первый ключ
+    iteration_keys[1] = key_2; // Второй ключ
+    key_pair key_pair_1_2(key_1, key_2); // Начальная пара
+    key_pair key_pair_3_4;
+    for (int i = 0; i < 4; i++) // 4 цикла по 8 итераций
+    {
+        key_pair_3_4 = F(key_pair_1_2, get_iteration_constant(0 + 8 * i));
+        key_pair_1_2 = F(key_pair_3_4, get_iteration_constant(1 + 8 * i));
+        key_pair_3_4 = F(key_pair_1_2, get_iteration_constant(2 + 8 * i));
+        key_pair_1_2 = F(key_pair_3_4, get_iteration_constant(3 + 8 * i));
+        key_pair_3_4 = F(key_pair_1_2, get_iteration_constant(4 + 8 * i));
+        key_pair_1_2 = F(key_pair_3_4, get_iteration_constant(5 + 8 * i));
+        key_pair_3_4 = F(key_pair_1_2, get_iteration_constant(6 + 8 * i));
+        key_pair_1_2 = F(key_pair_3_4, get_iteration_constant(7 + 8 * i));
+        iteration_keys[2 * i + 2] = key_pair_1_2.key_1; // Сохраняем ключи
+        iteration_keys[2 * i + 3] = key_pair_1_2.key_2;
+    }
+}
+
+// Шифрование одного блока (SP-сеть)
+block kuznechik::encrypt_block(const block& input_block) const
 {
-    std::string zero_string("000000000000000"); // 15 нулей для формирования 16-байтового блока
-    for (int i = 0; i < 32; i++) // Создаём 32 константы
+    block returned_block = input_block;
+    for (int i = 0; i < 9; i++) // 9 раундов
     {
-        std::string iterational_string;
-        iterational_string.push_back((char)i); // Первый байт — номер итерации
-        iterational_string += zero_string; // Остальные — нули
-        iteration_constants.push_back(L(block(iterational_string))); // Применяем L-преобразование
+        returned_block = get_iteration_key(i) ^ returned_block; // XOR с ключом
+        returned_block = S(returned_block); // Нелинейное преобразование
+        returned_block = L(returned_block); // Линейное преобразование
     }
+    returned_block = returned_block ^ get_iteration_key(9); // Финальный XOR
+    return returned_block;
 }
 
-// Получение значения маски для линейного преобразования
-unsigned char kuznechik::get_mask_value(int index) const
+// Заполнение таблиц L∘S (reversed — L⁻¹∘S⁻¹)
+constexpr constexpr_array<block[UCHAR_MAX + 1], block::size> kuznechik::calculate_ls_table(bool reversed)
 {
-    assert(index >= 0 && index < block::size && "Wrong index value"); // Проверка индекса
-    return mask[index]; // Возвращаем элемент из таблицы маски
+    // L здесь аффинно: L(x ^ y) = L(x) ^ L(y) ^ L(0), поэтому константа L(0) остаётся
+    // только в таблице нулевого байта, а из остальных 15 таблиц она вычитается (так же для L⁻¹)
+    const block linear_constant = reversed ? L_reversed(block()) : L(block());
+
+    // Столбцы линейной части L — образы блоков с одним установленным битом (128 вызовов L вместо 4096)
+    block linear_columns[8 * block::size];
+    for (int c = 0; c < 8 * block::size; c++)
+    {
+        block input_block;
+        input_block.set(c / 8, (unsigned char)(1 << (c % 8)));
+        linear_columns[c] = (reversed ? L_reversed(input_block) : L(input_block)) ^ linear_constant;
+    }
+
+    constexpr_array<block[UCHAR_MAX + 1], block::size> table = {};
+    for (int j = 0; j < block::size; j++) // Позиция байта
+        for (int v = 0; v <= UCHAR_MAX; v++) // Значение байта
+        {
+            // L(S(v) на позиции j) — сумма столбцов по установленным битам S(v)
+            block value = j == 0 ? linear_constant : block();
+            unsigned char substituted_value = reversed ? get_reversed_substituted_value(v) : get_substituted_value(v);
+            for (int bit = 0; bit < 8; bit++)
+                if ((substituted_value >> bit) & 1)
+                    value ^= linear_columns[8 * j + bit];
+            table.values[j][v] = value;
+        }
+    return table;
 }
 
-// Получение значения из таблицы подстановки S
-unsigned char kuznechik::get_substituted_value(int index) const
+constexpr constexpr_array<block[UCHAR_MAX + 1], block::size> kuznechik::ls_table = calculate_ls_table();
+constexpr constexpr_array<block[UCHAR_MAX + 1], block::size> kuznechik::ls_reversed_table = calculate_ls_table(true);
+
+// Подстановка в каждом байте: байты берутся из слов блока и собираются обратно без block::set
+block kuznechik::substitute_bytes(const block& input_block, bool reversed)
 {
-    assert(index >= 0 && index <= UCHAR_MAX && "Wrong index value"); // Проверка диапазона
-    return substitution_table[index]; // Возвращаем подстановку
+    const unsigned char* table = reversed ? substitution_table_reversed : substitution_table;
+    uint64_t lo = 0, hi = 0;
+    for (int j = 0; j < 8; j++)
+    {
+        lo |= (uint64_t)table[(input_block.low() >> (8 * j)) & 0xFF] << (8 * j);
+        hi |= (uint64_t)table[(input_block.high() >> (8 * j)) & 0xFF] << (8 * j);
+    }
+    return block(lo, hi);
 }
 
-// Получение значения из обратной таблицы подстановки S⁻¹
-unsigned char kuznechik::get_reversed_substituted_value(int index) const
+// Шифрование одного блока через таблицы L∘S: каждый раунд — 16 обращений к таблицам и XOR
+block kuznechik::encrypt_block_table(const block& input_block) const
 {
-    assert(index >= 0 && index <= UCHAR_MAX && "Wrong index value"); // Проверка диапазона
-    return substitution_table_reversed[index]; // Возвращаем обратную подстановку
+    block returned_block = input_block;
+    encrypt_blocks_generic(ls_table.values, key->iteration_keys(), &returned_block, 1);
+    return returned_block;
 }
 
-// Получение итерационной константы по индексу
-block kuznechik::get_iteration_constant(int index) const
+// Шифрование нескольких независимых блоков за один вызов
+void kuznechik::encrypt_blocks(block blocks[], size_t count) const
 {
-    assert(index >= 0 && index < 2 * block::size && "Wrong index value"); // Проверка (до 32)
-    return iteration_constants.at(index); // Возвращаем константу
+    encrypt_blocks_engine(dispatch_engine(count), blocks, count);
 }
 
-// Получение итерационного ключа по индексу
-block kuznechik::get_iteration_key(int index) const
+void kuznechik::decrypt_blocks(block blocks[], size_t count) const
 {
-    assert(index >= 0 && index < number_of_iteration_keys && "Wrong index value"); // Проверка (до 10)
-    return iteration_keys[index]; // Возвращаем ключ
+    decrypt_blocks_engine(dispatch_engine(count), blocks, count);
 }
 
-// Установка итерационного ключа
-void kuznechik::set_iteration_key(int index, const block value)
+void kuznechik::set_engine(engine_type new_engine)
 {
-    assert(index >= 0 && index < number_of_iteration_keys && "Wrong index value"); // Проверка
-    iteration_keys[index] = value; // Задаём ключ
+    engine = new_engine;
+    dispatch_profile::global().prepare(engine);
 }
 
-// Нелинейное преобразование S
-block kuznechik::S(const block input_block)
+engine_type kuznechik::dispatch_engine(size_t count) const
 {
-    std::vector<unsigned char> transformed_data;
-    for (int i = 0; i < block::size; i++) // Для каждого байта блока
-        transformed_data.push_back(get_substituted_value(input_block[i])); // Применяем подстановку
-    return block(transformed_data); // Возвращаем преобразованный блок
+    if (engine == engine_type::simd && count < (size_t)group_size && count < dispatch_profile::global().batch_blocks(engine))
+        return engine_type::table;
+    return engine;
 }
 
-// Обратное нелинейное преобразование S⁻¹
-block kuznechik::S_reversed(const block input_block)
+void kuznechik::parallel_for_blocks(size_t count, range_body body) const
 {
-    std::vector<unsigned char> transformed_data;
-    for (int i = 0; i < block::size; i++) // Для каждого байта
-        transformed_data.push_back(get_reversed_substituted_value(input_block[i])); // Обратная подстановка
-    return block(transformed_data); // Возвращаем блок
+    thread_pool& pool = thread_pool::global();
+    // Порог вычислен в set_engine для текущего числа потоков; если пул с тех пор пересоздан, он нулевой
+    const size_t serial_limit = pool.size() > 1 ? dispatch_profile::global().serial_blocks(engine, pool.size()) : 0;
+    pool.parallel_for(count, parallel_grain, body, serial_limit);
 }
 
-// Умножение в поле Галуа GF(2^8) для линейного преобразования
-unsigned char kuznechik::GF_mul(unsigned char a, unsigned char b)
+void kuznechik::encrypt_blocks_engine(engine_type block_engine, block blocks[], size_t count) const
 {
-    unsigned char c = 0;
-    for (int i = 0; i < 8; i++) // 8 бит в байте
+    switch (block_engine)
     {
-        if ((b & 1) == 1) // Если младший бит b равен 1
-            c ^= a; // Добавляем a к результату
-        unsigned char hi_bit = (char)(a & 0x80); // Проверяем старший бит a
-        a <<= 1; // Сдвиг a влево
-        if (hi_bit == 0) // Если был перенос
-            a ^= 0xC3; // Применяем полином x^8 + x^7 + x^6 + x + 1
-        b >>= 1; // Сдвиг b вправо
+        case engine_type::table:
+            encrypt_blocks_generic(ls_table.values, key->iteration_keys(), blocks, count);
+            break;
+        case engine_type::simd:
+            encrypt_blocks_simd(ls_table.values, key->iteration_keys(), blocks, count);
+            break;
+        case engine_type::bitsliced:
+            std::call_once(bitsliced_round_flag, &kuznechik::calculate_bitslice_circuit, this);
+            encrypt_blocks_bitsliced(bitsliced_round, key->iteration_keys(), blocks, count);
+            break;
+        default:
+            for (size_t i = 0; i < count; i++)
+                blocks[i] = encrypt_block(blocks[i]);
     }
-    return c; // Возвращаем произведение
 }
 
-// Внутреннее линейное преобразование R
-block kuznechik::R(const block input_block)
+// Дешифрование нескольких независимых блоков за один вызов
+// Раунды L⁻¹∘S⁻¹ считает ядро шифрования по таблицам ls_reversed_table (см. key_context::decryption_keys):
+// до него блок проходит S, после — S⁻¹ и XOR с K_1, то есть 9 табличных раундов, как при шифровании
+void kuznechik::decrypt_blocks_engine(engine_type block_engine, block blocks[], size_t count) const
 {
-    std::vector<unsigned char> transformed_data(block::size); // Новый блок
-    unsigned char trailing_symbol = 0; // Контрольная сумма
-    for (int i = block::size - 1; i >= 0; i--) // Сдвиг байтов вправо
+    if (block_engine == engine_type::table || block_engine == engine_type::simd)
     {
-        if (i == 0)
-            transformed_data[block::size] = input_block[i]; // Ошибка: должно быть block::size-1
+        const block* keys = key->decryption_keys();
+        for (size_t i = 0; i < count; i++)
+            blocks[i] = substitute_bytes(blocks[i], false);
+        if (block_engine == engine_type::table)
+            encrypt_blocks_generic(ls_reversed_table.values, keys, blocks, count);
         else
-            transformed_data[i - 1] = input_block[i]; // Сдвигаем
-        trailing_symbol ^= GF_mul(input_block[i], get_mask_value(i)); // Вычисляем сумму
+            encrypt_blocks_simd(ls_reversed_table.values, keys, blocks, count);
+        for (size_t i = 0; i < count; i++)
+            blocks[i] = substitute_bytes(blocks[i], true) ^ keys[number_of_iteration_keys];
     }
-    transformed_data[block::size - 1] = trailing_symbol; // Вставляем сумму
-    return block(transformed_data);
-}
-
-// Обратное внутреннее линейное преобразование R⁻¹
-block kuznechik::R_reversed(const block input_block)
-{
-    std::vector<unsigned char> transformed_data(block::size); // Новый блок
-    unsigned char leading_symbol = input_block[block::size - 1]; // Извлекаем сумму
-    for (int i = 1; i < block::size; i++) // Сдвиг влево
+    else if (block_engine == engine_type::bitsliced)
     {
-        transformed_data[i] = input_block[i - 1]; // Сдвигаем байты
-        leading_symbol ^= GF_mul(transformed_data[i], get_mask_value(i)); // Обновляем сумму
+        std::call_once(bitsliced_reversed_round_flag, &kuznechik::calculate_bitslice_reversed_circuit, this);
+        decrypt_blocks_bitsliced(bitsliced_reversed_round, key->iteration_keys(), blocks, count);
     }
-    transformed_data[0] = leading_symbol; // Вставляем результат
-    return block(transformed_data);
+    else
+        for (size_t i = 0; i < count; i++)
+            blocks[i] = decrypt_block(blocks[i]);
 }
 
-// Полное линейное преобразование L (16 итераций R)
-block kuznechik::L(const block input_block)
+// Дешифрование одного блока через таблицы L⁻¹∘S⁻¹
+block kuznechik::decrypt_block_table(const block& input_block) const
 {
-    block transformed_block = input_block;
-    for (int i = 0; i < block::size; i++) // 16 итераций
-        transformed_block = R(transformed_block); // Применяем R
-    return transformed_block;
+    const block* keys = key->decryption_keys();
+    block returned_block = substitute_bytes(input_block, false);
+    encrypt_blocks_generic(ls_reversed_table.values, keys, &returned_block, 1);
+    return substitute_bytes(returned_block, true) ^ keys[number_of_iteration_keys];
 }
 
-// Обратное линейное преобразование L⁻¹ (16 итераций R⁻¹)
-block kuznechik::L_reversed(const block input_block)
-{
-    block transformed_block = input_block;
-    for (int i = 0; i < block::size; i++) // 16 итераций
-        transformed_block = R_reversed(transformed_block); // Применяем R⁻¹
-    return transformed_block;
-}
-
-// Функция Фейстеля для генерации ключей
-key_pair kuznechik::F(const key_pair input_key_pair, const block iteration_constant)
-{
-    block returned_key_1;
-    block returned_key_2 = input_key_pair.key_1; // Сохраняем первый ключ
-    returned_key_1 = L(S(input_key_pair.key_2 ^ iteration_constant)) ^ returned_key_2; // SP-сеть + XOR
-    return key_pair(returned_key_1, returned_key_2); // Возвращаем новую пару ключей
-}
+bitslice_circuit kuznechik::bitsliced_round;
+std::once_flag kuznechik::bitsliced_round_flag;
 
-// Генерация итерационных ключей (сеть Фейстеля)
-void kuznechik::generate_iteraion_keys(block key_1, block key_2)
+// Построение битсрезовой схемы: столбцы L — образы блоков с одним установленным битом
+void kuznechik::calculate_bitslice_circuit() const
 {
-    iteration_keys[0] = key_1; // Первый ключ
-    iteration_keys[1] = key_2; // Второй ключ
-    key_pair key_pair_1_2(key_1, key_2); // Начальная пара
-    key_pair key_pair_3_4;
-    for (int i = 0; i < 4; i++) // 4 цикла по 8 итераций
+    const block linear_constant = L(block());
+    block linear_columns[bitslice_circuit::block_bits];
+    for (int c = 0; c < bitslice_circuit::block_bits; c++)
     {
-        key_pair_3_4 = F(key_pair_1_2, get_iteration_constant(0 + 8 * i));
-        key_pair_1_2 = F(key_pair_3_4, get_iteration_constant(1 + 8 * i));
-        key_pair_3_4 = F(key_pair_1_2, get_iteration_constant(2 + 8 * i));
-        key_pair_1_2 = F(key_pair_3_4, get_iteration_constant(3 + 8 * i));
-        key_pair_3_4 = F(key_pair_1_2, get_iteration_constant(4 + 8 * i));
-        key_pair_1_2 = F(key_pair_3_4, get_iteration_constant(5 + 8 * i));
-        key_pair_3_4 = F(key_pair_1_2, get_iteration_constant(6 + 8 * i));
-        key_pair_1_2 = F(key_pair_3_4, get_iteration_constant(7 + 8 * i));
-        set_iteration_key(2 * i + 2, key_pair_1_2.key_1); // Сохраняем ключи
-        set_iteration_key(2 * i + 3, key_pair_1_2.key_2);
+        block input_block;
+        input_block.set(c / 8, (unsigned char)(1 << (c % 8)));
+        linear_columns[c] = L(input_block) ^ linear_constant;
     }
+    build_bitslice_circuit(substitution_table, linear_columns, linear_constant, bitsliced_round);
 }
 
-// Шифрование одного блока (SP-сеть)
-block kuznechik::encrypt_block(const block input_block)
+bitslice_circuit kuznechik::bitsliced_reversed_round;
+std::once_flag kuznechik::bitsliced_reversed_round_flag;
+
+// Обратная схема: S⁻¹ и столбцы L⁻¹
+void kuznechik::calculate_bitslice_reversed_circuit() const
 {
-    block returned_block = input_block;
-    for (int i = 0; i < 9; i++) // 9 раундов
+    const block linear_constant = L_reversed(block());
+    block linear_columns[bitslice_circuit::block_bits];
+    for (int c = 0; c < bitslice_circuit::block_bits; c++)
     {
-        returned_block = get_iteration_key(i) ^ returned_block; // XOR с ключом
-        returned_block = S(returned_block); // Нелинейное преобразование
-        returned_block = L(returned_block); // Линейное преобразование
+        block input_block;
+        input_block.set(c / 8, (unsigned char)(1 << (c % 8)));
+        linear_columns[c] = L_reversed(input_block) ^ linear_constant;
     }
-    returned_block = returned_block ^ get_iteration_key(9); // Финальный XOR
-    return returned_block;
+    build_bitslice_circuit(substitution_table_reversed, linear_columns, linear_constant, bitsliced_reversed_round);
 }
 
 // Дешифрование одного блока (обратная SP-сеть)
-block kuznechik::decrypt_block(const block input_block)
+block kuznechik::decrypt_block(const block& input_block) const
 {
     block returned_block = input_block ^ get_iteration_key(9); // Убираем последний ключ
     for (int i = 8; i >= 0; i--) // 9 раундов в обратном порядке
@@ -450,64 +497,77 @@ block kuznechik::decrypt_block(const block input_block)
 }
 
 // Запись данных в файл
-void kuznechik::write_to_file(const char* output_file, bool use_hex)
+void kuznechik::write_to_file(const char* output_file, bool use_hex, cipher_stats& stats)
 {
+    double start = omp_get_wtime();
     std::ofstream output_stream;
     output_stream.open(output_file); // Открываем файл
     assert(output_stream.is_open() && "Can't open file"); // Проверяем
-    for (block i : data) // Для каждого блока
-        if (use_hex == true)
-            output_stream << hex_to_string(std::string(i.get_data().begin(), i.get_data().end())); // В hex
-        else
-            output_stream << std::string(i.get_data().begin(), i.get_data().end()); // Как есть
+    // Блоки хранятся подряд, поэтому пишем их через один буфер, без строки на каждый блок
+    std::vector<unsigned char> output_bytes(data.size() * block::size);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i].store(output_bytes.data() + i * block::size);
+    // В режимах гаммирования длина сохраняется: дополнение последнего блока не записывается
+    size_t output_length = is_length_preserving(mode) ? data_length : output_bytes.size();
+    if (use_hex == true)
+    {
+        // В hex кодируем кусками через один буфер
+        std::vector<char> hexadecimal(hex_chunk_size);
+        double hex_time = 0;
+        for (size_t i = 0; i < output_length; i += hex_chunk_size / 2)
+        {
+            size_t length = std::min(hex_chunk_size / 2, output_length - i);
+            double hex_start = omp_get_wtime();
+            hex_encode(output_bytes.data() + i, length, hexadecimal.data());
+            hex_time += omp_get_wtime() - hex_start;
+            output_stream.write(hexadecimal.data(), 2 * length);
+        }
+        stats.hex_time += hex_time;
+        stats.write_time -= hex_time; // Кодирование не считается записью
+    }
+    else
+        output_stream.write((const char*)output_bytes.data(), output_length); // Как есть
+    output_stream.close();
+    stats.write_time += omp_get_wtime() - start;
 }
 
 // Конструктор блока из вектора байтов
-block::block(std::vector<unsigned char> input_string) : data(input_string) 
-{ 
+block::block(const std::vector<unsigned char>& input_string) : words{0, 0}
+{
     assert(input_string.size() == size); // Проверка размера
-};
-
-// Конструктор пустого блока
-block::block() 
-{ 
-    data.resize(size); // Устанавливаем размер 16 байт
+    *this = block(input_string.data());
 }
 
 // Конструктор блока из строки
-block::block(std::string input_string)
+block::block(const std::string& input_string) : words{0, 0}
 {
     assert(input_string.length() == size && "Wrong length of the block"); // Проверка длины
-    for (int i = 0; i < size; i++)
-        data.push_back(input_string[i]); // Заполняем байты
+    *this = block((const unsigned char*)input_string.data());
 }
 
-// Доступ к байту блока по индексу
-unsigned char block::operator[](const int index) const
+// Запись 16 байтов блока в память
+void block::store(unsigned char* bytes) const
 {
-    assert(index < size && "given index causes overflow"); // Проверка
-    return data[index]; // Возвращаем байт
+    for (int i = 0; i < size; i++)
+        bytes[i] = (*this)[i];
 }
 
-// Оператор XOR для блоков
-block operator^(const block& a, const block& b)
+// Байты блока в виде строки
+std::string block::to_string() const
 {
-    block result;
-    for (int i = 0; i < result.size; i++)
-        result.data[i] = b[i] ^ a[i]; // Побитовое XOR
+    std::string result(size, '\0');
+    store((unsigned char*)&result[0]);
     return result;
 }
 
 // Вывод блока в поток
 std::ostream& operator<<(std::ostream& os, const block& b)
 {
-    return os << b.data << std::endl; // Выводим данные
+    return os << b.to_string() << std::endl; // Выводим данные
 }
 
 // Печать блока в консоль
-void block::print()
+void block::print() const
 {
-    for (int i : data)
-        std::cout << (unsigned char)i; // Печатаем каждый байт
-    std::cout << std::endl;
+    std::cout << to_string() << std::endl; // Печатаем байты
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+#pragma once
 #include <vector>
 #include <cassert>
 #include <iostream>
@@ -5,58 +6,104 @@
 #include <fstream>
 #include <string>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <mutex>
+#include <future>
+#include <span>
+#include <optional>
+#include <cstddef>
 #include <omp.h>
+#include "kuznechik_block.h"
+#include "kuznechik_key.h"
+#include "kuznechik_simd.h"
+#include "kuznechik_bitslice.h"
+#include "kuznechik_pool.h"
+#include "kuznechik_gf128.h"
+#include "kuznechik_hex.h"
+#include "kuznechik_stats.h"
 
-void encrypt_file( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2);
-void encrypt_file( const char* input_file_name, const char* output_file_name, const char* hexadecimal_key);
+// Способ вычисления раундов шифрования
+enum class engine_type
+{
+    reference, // Эталонный: S, затем L (16 итераций R с умножением в поле Галуа)
+    table,     // Табличный: предвычисленные таблицы объединённого преобразования L∘S
+    simd,      // Табличный в векторных регистрах, набор инструкций выбирается по cpuid (см. simd_isa)
+    bitsliced  // Битсрезовый: 64 блока за раз без обращений к таблицам по данным блоков (ключ развёртывается по таблицам)
+};
 
-void decrypt_file( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2);
-void decrypt_file( const char* input_file_name, const char* output_file_name, const char* hexadecimal_key);
+// Режим шифрования (ГОСТ Р 34.13-2015)
+enum class cipher_mode
+{
+    ecb, // Простая замена: последний блок дополняется пробелами
+    ctr, // Гаммирование: гамма — зашифрованный счётчик, длина данных сохраняется
+    ctr_acpkm, // CTR со сменой ключа каждой секции (ACPKM, Р 1323565.1.017-2018, RFC 8645), длина данных сохраняется
+    cbc, // Простая замена с зацеплением: последний блок дополняется пробелами
+    cfb, // Гаммирование с обратной связью по шифртексту, длина данных сохраняется
+    ofb, // Гаммирование с обратной связью по выходу, длина данных сохраняется
+    mgm  // Аутентифицированное шифрование MGM (Р 1323565.1.026-2019): к шифртексту дописывается имитовставка
+};
 
-const char* const hex_symbol_table = "0123456789abcdef";
+// Сохраняет ли режим длину данных (последний блок не дополняется, а обрезается)
+constexpr bool is_length_preserving(cipher_mode mode) { return mode == cipher_mode::ctr || mode == cipher_mode::ctr_acpkm || mode == cipher_mode::cfb || mode == cipher_mode::ofb || mode == cipher_mode::mgm; }
 
-std::string char_to_hex_string( char c);
-std::string hex_to_string ( const std::string input_string);
-std::string string_to_hex ( const std::string input_string);
-// Структура для представления 16-байтового блока данных (128 бит)
-struct block
-{
-    public:
-        static const int size = 16; // Размер блока в байтах (фиксирован для "Кузнечика")
+// Все функции шифрования файлов возвращают статистику: время фаз, объём, блоки по потокам (kuznechik_stats.h)
+cipher_stats encrypt_file( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine = engine_type::table, cipher_mode mode = cipher_mode::ecb, const block& initialization_vector = block());
+cipher_stats encrypt_file( const char* input_file_name, const char* output_file_name, const char* hexadecimal_key, engine_type engine = engine_type::table, cipher_mode mode = cipher_mode::ecb, const block& initialization_vector = block());
 
-        block(); // Конструктор по умолчанию
-        block(std::vector<unsigned char> input_string); // Конструктор из вектора байтов
-        block(std::string input_string); // Конструктор из строки (исправлено: input_string)
+// При расшифровании stats.authentic == false, если в режиме MGM не сошлась имитовставка (выходной файл тогда не создаётся)
+cipher_stats decrypt_file( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine = engine_type::table, cipher_mode mode = cipher_mode::ecb, const block& initialization_vector = block());
+cipher_stats decrypt_file( const char* input_file_name, const char* output_file_name, const char* hexadecimal_key, engine_type engine = engine_type::table, cipher_mode mode = cipher_mode::ecb, const block& initialization_vector = block());
 
-        unsigned char operator[](const int index) const; // Доступ к байту по индексу
-        friend block operator^(const block& a, const block& b); // Оператор XOR для блоков
-        friend std::ostream& operator<<(std::ostream& os, const block& b); // Вывод блока в поток
-        const std::vector<unsigned char>& get_data() const { return data; } // Получение данных блока
+// Варианты через отображение файлов в память (mmap); output_file_name == nullptr — шифрование на месте
+cipher_stats encrypt_file_mapped( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine = engine_type::table, cipher_mode mode = cipher_mode::ecb, const block& initialization_vector = block());
+cipher_stats decrypt_file_mapped( const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine = engine_type::table, cipher_mode mode = cipher_mode::ecb, const block& initialization_vector = block());
 
-        void mod(); // Модификация блока (не реализована в коде)
-        void print(); // Печать блока в консоль
-    private:
-        std::vector<unsigned char> data; // Внутреннее хранение байтов блока
-};
+const char* const hex_symbol_table = "0123456789abcdef";
 
+std::string char_to_hex_string( char c);
+std::string hex_to_string ( const std::string input_string);
+std::string string_to_hex ( const std::string input_string);
 // Структура для хранения пары ключей (используется в сети Фейстеля)
 struct key_pair
 {
     block key_1; // Первый 16-байтовый ключ
     block key_2; // Второй 16-байтовый ключ
-    key_pair(block key_1, block key_2) : key_1(key_1), key_2(key_2) {} // Конструктор с параметрами
+    constexpr key_pair(const block& key_1, const block& key_2) : key_1(key_1), key_2(key_2) {} // Конструктор с параметрами
     key_pair() = default; // Конструктор по умолчанию
 };
 
-// Оператор вывода блока в поток (внешняя реализация)
-std::ostream& operator<<(std::ostream& os, const block& b);
+// Файл, обрабатываемый в пакете (kuznechik::encrypt_files)
+struct batch_file;
+
+// Цепочка ключей секций CTR-ACPKM одного потока (kuznechik::encrypt_chunk)
+struct acpkm_chain;
+
+// Сообщение для пакетной обработки (kuznechik::ctr_crypt_batch)
+struct batch_message
+{
+    block key_1; // Первая половина ключа сообщения
+    block key_2; // Вторая половина ключа сообщения
+    uint64_t initialization_vector; // Синхропосылка CTR
+    const unsigned char* input; // length байтов
+    unsigned char* output; // length байтов (может совпадать с input)
+    size_t length;
+};
+
+// Массив в структуре: constexpr-функция может вернуть его целиком (таблицы, вычисляемые при компиляции)
+template <typename T, size_t N>
+struct constexpr_array
+{
+    T values[N];
+    constexpr const T& operator[](size_t index) const { return values[index]; }
+};
 
 // Класс, реализующий шифр "Кузнечик"
 class kuznechik
 {
     private:
         // Таблица подстановок S для нелинейного преобразования (256 значений)
-        const unsigned char substitution_table[UCHAR_MAX + 1] =
+        static constexpr unsigned char substitution_table[UCHAR_MAX + 1] =
         {
             (unsigned char)0xFC, (unsigned char)0xEE, (unsigned char)0xDD, (unsigned char)0x11, (unsigned char)0xCF, (unsigned char)0x6E, (unsigned char)0x31, (unsigned char)0x16,
             (unsigned char)0xFB, (unsigned char)0xC4, (unsigned char)0xFA, (unsigned char)0xDA, (unsigned char)0x23, (unsigned char)0xC5, (unsigned char)0x04, (unsigned char)0x4D,
@@ -93,7 +140,7 @@ class kuznechik
         };
 
         // Обратная таблица подстановок S⁻¹ для дешифрования
-        const unsigned char substitution_table_reversed[UCHAR_MAX + 1] =
+        static constexpr unsigned char substitution_table_reversed[UCHAR_MAX + 1] =
         {
             (unsigned char)0xA5, (unsigned char)0x2D, (unsigned char)0x32, (unsigned char)0x8F, (unsigned char)0x0E, (unsigned char)0x30, (unsigned char)0x38, (unsigned char)0xC0,
             (unsigned char)0x54, (unsigned char)0xE6, (unsigned char)0x9E, (unsigned char)0x39, (unsigned char)0x55, (unsigned char)0x7E, (unsigned char)0x52, (unsigned char)0x91,
@@ -130,75 +177,416 @@ class kuznechik
         };
 
         // Маска для линейного преобразования R (16 значений)
-        const unsigned char mask[block::size] =
+        static constexpr unsigned char mask[block::size] =
         {
             (unsigned char)1, (unsigned char)148, (unsigned char)32, (unsigned char)133, (unsigned char)16, (unsigned char)194, (unsigned char)192, (unsigned char)1,
             (unsigned char)251, (unsigned char)1, (unsigned char)192, (unsigned char)194, (unsigned char)16, (unsigned char)133, (unsigned char)32, (unsigned char)148
         };
 
-        const int number_of_iteration_keys = 10; // Количество итерационных ключей (10 раундов)
+        static const int number_of_iteration_keys = key_context::number_of_iteration_keys; // Количество итерационных ключей (10 раундов)
+        static const int number_of_iteration_constants = 32; // Количество итерационных констант
+        static const int group_size = bitslice_circuit::batch_size; // Количество блоков data, шифруемых за один вызов
+        static const size_t parallel_grain = 4096; // Блоков в куске для пула потоков (64 КБ, целое число групп)
 
         std::vector<block> data; // Вектор блоков данных для шифрования/дешифрования
-        std::vector<block> iteration_constants; // Итерационные константы для сети Фейстеля
-        std::vector<block> iteration_keys; // Итерационные ключи для раундов
+        size_t data_length = 0; // Длина исходных данных в байтах (без дополнения последнего блока)
+        cipher_stats load_stats; // Время чтения data из файла (входит в статистику encrypt_data и decrypt_data)
+        // Итерационные константы для сети Фейстеля, не зависят от ключа и вычисляются при компиляции
+        static const constexpr_array<block, number_of_iteration_constants> iteration_constants;
+        std::shared_ptr<const key_context> key; // Развёрнутый ключ, может быть общим с другими объектами и кэшем
 
         // Чтение файла в буфер данных
         void read_file_to_data_buffer(const char* file_name, bool is_hex = false);
         // Вычисление итерационных констант
-        void calculate_iteration_constants();
-        // Генерация итерационных ключей через сеть Фейстеля
-        void generate_iteraion_keys(block key_1, block key_2);
+        static constexpr constexpr_array<block, number_of_iteration_constants> calculate_iteration_constants();
+        // Генерация итерационных ключей через сеть Фейстеля эталонными S и L
+        static void generate_iteraion_keys(const block& key_1, const block& key_2, block iteration_keys[]);
+        // Развёртывание count ключей сразу через таблицы L∘S (для key_context и пакетов сообщений)
+        // - keys_1, keys_2: половины ключей
+        // - iteration_keys: count × 10 итерационных ключей подряд
+        // Сети Фейстеля разных ключей независимы и чередуются, результат совпадает с generate_iteraion_keys
+        static void expand_keys(const block keys_1[], const block keys_2[], size_t count, block iteration_keys[]);
+        // Один раунд L∘S через таблицы (16 обращений)
+        static block ls_round(const block& input_block);
+        friend class key_context;
+        friend class kuznechik_bench; // Замеры отдельных преобразований (bench.cpp)
+        friend class cmac; // Имитовставка: цепочка блоков через таблицы L∘S (kuznechik_mac.h)
+        friend class dispatch_profile; // Калибровка порогов прямыми вызовами движков (kuznechik_dispatch.h)
 
         // Получение значения из маски
-        unsigned char get_mask_value(int index) const;
+        static constexpr unsigned char get_mask_value(int index);
         // Получение значения из таблицы S
-        unsigned char get_substituted_value(int index) const;
+        static constexpr unsigned char get_substituted_value(int index);
         // Получение значения из таблицы S⁻¹
-        unsigned char get_reversed_substituted_value(int index) const;
+        static constexpr unsigned char get_reversed_substituted_value(int index);
 
         // Получение итерационной константы
-        block get_iteration_constant(int index) const;
+        static const block& get_iteration_constant(int index);
         // Получение итерационного ключа
-        block get_iteration_key(int index) const;
-        // Установка итерационного ключа
-        void set_iteration_key(int index, const block value);
+        const block& get_iteration_key(int index) const;
 
         // Умножение в поле Галуа для линейного преобразования
-        static unsigned char GF_mul(unsigned char a, unsigned char b);
+        static constexpr unsigned char GF_mul(unsigned char a, unsigned char b);
 
         // Линейное преобразование L (16 итераций R)
-        block L(const block input_block);
+        static constexpr block L(const block& input_block);
         // Внутреннее преобразование R для L
-        block R(const block input_block);
+        static constexpr block R(const block& input_block);
         // Нелинейное преобразование S
-        block S(const block input_block);
+        static constexpr block S(const block& input_block);
 
         // Обратное линейное преобразование L⁻¹
-        block L_reversed(const block input_block);
+        static constexpr block L_reversed(const block& input_block);
         // Обратное внутреннее преобразование R⁻¹
-        block R_reversed(const block input_block);
+        static constexpr block R_reversed(const block& input_block);
         // Обратное нелинейное преобразование S⁻¹
-        block S_reversed(const block input_block);
+        static constexpr block S_reversed(const block& input_block);
 
         // Функция Фейстеля для генерации ключей
-        key_pair F(const key_pair input_key_pair, const block iteration_constant);
+        static constexpr key_pair F(const key_pair& input_key_pair, const block& iteration_constant);
+
+        // Таблицы L∘S: ls_table[j][v] — результат L(S(x)) для блока x, у которого j-й байт равен v, а остальные нулевые
+        // 16×256 блоков, вычисляются при компиляции и общие для всех объектов
+        static const constexpr_array<block[UCHAR_MAX + 1], block::size> ls_table;
+        // Таблицы L⁻¹∘S⁻¹ для расшифрования, устроены так же: ls_reversed_table[j][v] — L⁻¹(S⁻¹(x))
+        static const constexpr_array<block[UCHAR_MAX + 1], block::size> ls_reversed_table;
+        // Заполнение таблиц L∘S (reversed — L⁻¹∘S⁻¹) через эталонные S и L
+        static constexpr constexpr_array<block[UCHAR_MAX + 1], block::size> calculate_ls_table(bool reversed = false);
+        // Подстановка S (reversed — S⁻¹) в каждом байте блока, без раунда L
+        static block substitute_bytes(const block& input_block, bool reversed);
+
+        engine_type engine = engine_type::table; // Выбранный способ шифрования
+        cipher_mode mode = cipher_mode::ecb; // Выбранный режим шифрования
+        block initialization_vector; // Синхропосылка (для CTR используются младшие 8 байтов, для MGM — ICN)
+        size_t acpkm_section_size = acpkm_default_section_size; // Размер секции CTR-ACPKM в байтах
+
+        // Битсрезовая схема раунда, строится один раз на процесс при первом использовании
+        static bitslice_circuit bitsliced_round;
+        static std::once_flag bitsliced_round_flag;
+        // Построение битсрезовой схемы через эталонные S и L
+        void calculate_bitslice_circuit() const;
+        // Схема обратного раунда (S⁻¹ и L⁻¹) для расшифрования, строится так же при первом использовании
+        static bitslice_circuit bitsliced_reversed_round;
+        static std::once_flag bitsliced_reversed_round_flag;
+        void calculate_bitslice_reversed_circuit() const;
 
         // Шифрование одного блока (SP-сеть)
-        block encrypt_block(const block input_block);
+        block encrypt_block(const block& input_block) const;
+        // Шифрование одного блока через таблицы L∘S (результат совпадает с encrypt_block)
+        block encrypt_block_table(const block& input_block) const;
         // Дешифрование одного блока (обратная SP-сеть)
-        block decrypt_block(const block input_block);
+        block decrypt_block(const block& input_block) const;
+        // Дешифрование одного блока через таблицы L⁻¹∘S⁻¹ (результат совпадает с decrypt_block)
+        block decrypt_block_table(const block& input_block) const;
+
+        // encrypt_blocks и decrypt_blocks заданным движком, без выбора пути по числу блоков
+        void encrypt_blocks_engine(engine_type block_engine, block blocks[], size_t count) const;
+        void decrypt_blocks_engine(engine_type block_engine, block blocks[], size_t count) const;
+        // Движок для count блоков: неполную группу меньше порога dispatch_profile::batch_blocks табличный
+        // движок шифрует быстрее векторного. Битсрезовый не подменяется: он выбран, чтобы данные блоков не попадали в адреса таблиц
+        // Вызывается на каждую пачку, в том числе в потоках пула: только читает готовый порог
+        engine_type dispatch_engine(size_t count) const;
+        // Распределение count блоков по потокам пула кусками по parallel_grain; не больше порога
+        // dispatch_profile::serial_blocks для выбранного движка — в вызывающем потоке
+        void parallel_for_blocks(size_t count, range_body body) const;
+
+        // Гамма для режима CTR: count зашифрованных значений счётчика, начиная с блока first_block
+        void generate_ctr_gamma(block gamma[], size_t count, uint64_t initialization_vector, uint64_t first_block) const;
+        // Наложение гаммы CTR на count блоков на месте, блоки распределяются между потоками группами
+        void apply_ctr_gamma(block blocks[], size_t count, uint64_t initialization_vector, uint64_t first_block) const;
+        // То же в режиме CTR-ACPKM: счётчик сквозной, гамма каждой секции — под ключом этой секции
+        // Ключи секций выводятся в chain до распараллеливания (цепочка последовательна), после чего потоки
+        // шифруют разные секции одновременно; за раз — не больше acpkm_chain::capacity секций
+        void apply_acpkm_gamma(block blocks[], size_t count, uint64_t initialization_vector, uint64_t first_block, acpkm_chain& chain) const;
+        // Шифр секции section в кольце chain по шифру секции section - 1: ключ ACPKM(K) = E_K(D_1) || E_K(D_2),
+        // D = 80 81 … 9F (Р 1323565.1.017-2018, RFC 8645), движок — этого объекта
+        void next_acpkm_cipher(acpkm_chain& chain, uint64_t section) const;
+
+        // Режимы с зацеплением над count блоками на месте (ГОСТ Р 34.13-2015, регистр из одного блока)
+        // Зашифрование последовательное: каждый блок зависит от предыдущего
+        void cbc_encrypt(block blocks[], size_t count, const block& initialization_vector) const;
+        void cfb_encrypt(block blocks[], size_t count, const block& initialization_vector) const;
+        // Расшифрование параллельное: все блоки шифртекста известны заранее
+        void cbc_decrypt(block blocks[], size_t count, const block& initialization_vector) const;
+        void cfb_decrypt(block blocks[], size_t count, const block& initialization_vector) const;
+        // OFB: гамма — цепочка зашифрований синхропосылки, одинакова для обоих направлений
+        void ofb_crypt(block blocks[], size_t count, const block& initialization_vector) const;
+        // Блоки, предшествующие каждому куску пула (parallel_grain блоков) в окне из count блоков, для первого —
+        // first: их нужно прочитать до того, как соседние куски перезапишут данные на месте
+        static void collect_chunk_predecessors(const block blocks[], size_t count, const block& first, block predecessors[]);
+
+        // Зашифрование и расшифрование count блоков — очередного куска потока — на месте в выбранном режиме
+        // - first_block: номер первого блока куска в потоке (счётчик CTR)
+        // - chaining_block: регистр режимов с зацеплением, на входе — состояние после предыдущего куска
+        //   (для первого — синхропосылка), на выходе — состояние для следующего
+        // - acpkm: ключи секций CTR-ACPKM, выведенные предыдущими кусками потока (для первого — пустая цепочка)
+        void encrypt_chunk(block blocks[], size_t count, uint64_t first_block, block& chaining_block, acpkm_chain& acpkm) const;
+        void decrypt_chunk(block blocks[], size_t count, uint64_t first_block, block& chaining_block, acpkm_chain& acpkm) const;
+
+        // Участок данных MGM: length байтов, первый блок участка — блок first_block данных
+        // Если output не nullptr, блоки шифруются (decrypt — расшифровываются) гаммой E(Y_first_block+i);
+        // в имитовставку входят H_i ⊗ C_i, где H_i = E(Z_first_hash+i), C_i — шифртекст (или открытые
+        // данные при output == nullptr), неполный последний блок дополняется нулями
+        // Гамма и H вычисляются одной пачкой, куски распределяются между потоками; возвращается сумма слагаемых
+        block mgm_process(const block& y_1, const block& z_1, uint64_t first_block, uint64_t first_hash, const unsigned char* input, unsigned char* output, size_t length, bool decrypt) const;
+        // Начальные счётчики MGM: Y_1 = E(0 || ICN), Z_1 = E(1 || ICN)
+        void mgm_counters(const block& nonce, block& y_1, block& z_1) const;
+        // Имитовставка по сумме слагаемых: E(sum ⊕ H_h+q+1 ⊗ (len(A) || len(C)))
+        void mgm_finish(const block& z_1, block sum, size_t associated_length, size_t length, unsigned char tag[block::size]) const;
+
+        // Размер куска потоковой обработки файла в байтах, кратен group_size блокам
+        static const size_t stream_chunk_size = 1 << 22;
+        // Потоковая обработка файла: кусок N шифруется, пока кусок N+1 читается, а кусок N-1 записывается
+        // В режиме MGM имитовставка дописывается в конец файла и проверяется при расшифровании (authentic — сошлась ли)
+        cipher_stats process_stream(const char* input_file_name, const char* output_file_name, bool is_hex, bool decrypt) const;
+
+        // Размер окна при обработке отображённого файла: окно копируется и шифруется, пока лежит в кэше
+        static const size_t mapped_window_size = 1 << 20;
+        // Обработка файла через отображение в память (mmap), output_file_name == nullptr — на месте
+        cipher_stats process_mapped(const char* input_file_name, const char* output_file_name, bool decrypt) const;
+
+        // Окно обработки буфера в памяти: выровненный выходной буфер шифруется на месте окнами по
+        // span_window_size байтов (окно копируется из входного и шифруется, пока лежит в кэше),
+        // невыровненный — через буфер на стеке по span_stack_blocks блоков
+        static const size_t span_window_size = 1 << 20;
+        // Окно расшифрования CBC и CFB: блоки перед кусками пула окна помещаются в массив на стеке
+        static const size_t chaining_window_blocks = span_window_size / block::size;
+        static_assert(chaining_window_blocks % parallel_grain == 0, "Chaining window must consist of whole pool chunks");
+        static const size_t span_stack_blocks = 4 * group_size;
+        // Обработка length байтов input в output (длина output — с дополнением последнего блока), кроме MGM
+        void process_span(const unsigned char* input, unsigned char* output, size_t length, bool decrypt) const;
+
+        // Пакетная обработка файлов: до batch_files_in_flight файлов одновременно, каждый читается целиком,
+        // шифруется в памяти и записывается. Чтение и запись идут асинхронно (io_queue) и перекрываются с
+        // шифрованием уже прочитанных файлов. Файлы больше batch_file_size_limit обрабатываются потоково после остальных
+        static const size_t batch_files_in_flight = 128;
+        static const size_t batch_file_size_limit = 1 << 23;
+        // Предел памяти под буферы файлов в обработке
+        static const size_t batch_memory_limit = 1 << 26;
+        cipher_stats process_files(const std::vector<std::string>& input_file_names, const std::vector<std::string>& output_file_names, bool decrypt, bool use_io_uring) const;
+        // Шифрование файла, целиком прочитанного в буфер, в выбранном режиме
+        void process_file_bytes(batch_file& file, bool decrypt) const;
 
         // Запись данных в файл
-        void write_to_file(const char* output_file, bool use_hex = false);
+        void write_to_file(const char* output_file, bool use_hex, cipher_stats& stats);
 
     public:
-        // Конструктор с двумя ключами
-        kuznechik(const char* file_name, const block key_1, const block key_2);
-        // Конструктор с hex-ключом
+        // Конструктор с уже развёрнутым ключом, без данных: развёртывание не повторяется
+        explicit kuznechik(std::shared_ptr<const key_context> key);
+        // Конструктор с двумя ключами, без данных (для потоковой обработки файлов)
+        // Ключ развёртывается через общий кэш key_cache::global()
+        kuznechik(const block& key_1, const block& key_2);
+        // Конструктор с hex-ключом, без данных (тоже через общий кэш)
+        explicit kuznechik(const char* hexadecimal_key);
+        // Конструктор с двумя ключами, читающий файл целиком
+        kuznechik(const char* file_name, const block& key_1, const block& key_2);
+        // Конструктор с hex-ключом, читающий файл целиком
         kuznechik(const char* file_name, const char* hexadecimal_key);
 
+        // Выбор способа шифрования (по умолчанию табличный)
+        // Пороги выбора пути для движка (dispatch_profile) вычисляются здесь, один раз на процесс
+        void set_engine(engine_type new_engine);
+        // Выбор режима шифрования и синхропосылки (по умолчанию простая замена)
+        void set_mode(cipher_mode new_mode, const block& new_initialization_vector = block()) { mode = new_mode; initialization_vector = new_initialization_vector; }
+        // Размер секции CTR-ACPKM в байтах, кратен размеру блока (по умолчанию acpkm_default_section_size)
+        void set_acpkm_section_size(size_t new_section_size);
+        static const size_t acpkm_default_section_size = 1 << 18;
+
+        // Шифрование count независимых блоков на месте за один вызов
+        // Табличный и векторный движки чередуют блоки, битсрезовый обрабатывает по 64
+        void encrypt_blocks(block blocks[], size_t count) const;
+        // Дешифрование count независимых блоков на месте за один вызов
+        // Табличный и векторный движки считают раунды по таблицам L⁻¹∘S⁻¹ с ключами из key_context::decryption_keys
+        // тем же ядром, что и шифрование, битсрезовый — обратной схемой раунда
+        void decrypt_blocks(block blocks[], size_t count) const;
+
+        // Режим CTR над произвольным участком потока: шифрование и дешифрование совпадают
+        // - input, output: length байтов (могут совпадать для работы на месте)
+        // - initialization_vector: синхропосылка, старшая половина счётчика (младшая — номер блока)
+        // - offset: смещение первого байта input в потоке, гамма начинается с блока offset / 16
+        void ctr_crypt(const unsigned char* input, unsigned char* output, size_t length, uint64_t initialization_vector, uint64_t offset = 0) const;
+
+        // Пакетный режим CTR: count независимых сообщений, каждое под своим ключом (шифрование и дешифрование совпадают)
+        // Ключи развёртываются по несколько сразу, блоки гаммы разных сообщений собираются в общие группы:
+        // в одном векторном регистре и в одном куске пула оказываются блоки разных сообщений и ключей
+        // Табличный и векторный движки; эталонный и битсрезовый обрабатывают сообщения по одному
+        static void ctr_crypt_batch(const batch_message messages[], size_t count, engine_type engine = engine_type::simd);
+
+        // Аутентифицированное шифрование MGM (Р 1323565.1.026-2019, RFC 9058): length байтов input шифруются в output,
+        // имитовставка tag защищает шифртекст и associated_data (открытые данные, которые только аутентифицируются)
+        // Гамма и слагаемые имитовставки считаются за один проход по данным, куски распределяются между потоками
+        // - nonce: синхропосылка ICN, старший бит байта 15 не используется (ICN — 127 бит)
+        // - неполный последний блок, как в стандарте, занимает старшие байты блока
+        // - input и output могут совпадать
+        void mgm_encrypt(const block& nonce, const unsigned char* associated_data, size_t associated_length, const unsigned char* input, unsigned char* output, size_t length, unsigned char tag[block::size]) const;
+        // Расшифрование MGM с проверкой имитовставки; если она не сошлась, output обнуляется и возвращается false
+        bool mgm_decrypt(const block& nonce, const unsigned char* associated_data, size_t associated_length, const unsigned char* input, unsigned char* output, size_t length, const unsigned char tag[block::size]) const;
+
+        // Шифрование и дешифрование буфера в памяти, без файлов и без выделения памяти в куче: таблица
+        // зацепления CBC и CFB и ключи секций CTR-ACPKM лежат в массивах фиксированного размера на стеке
+        // Результат — тот же, что в файле после encrypt_file: в ECB и CBC неполный последний блок дополняется
+        // пробелами, в MGM за шифртекстом идёт имитовставка (associated_data только аутентифицируется)
+        // - input и output могут совпадать (работа на месте), иначе не должны перекрываться
+        // - output не короче encrypted_size(input.size()) или decrypted_size(input.size())
+        // Выровненный по 16 байтам output шифруется на месте пулом потоков; decrypt возвращает false, если
+        // имитовставка MGM не сошлась (output тогда обнулён)
+        size_t encrypted_size(size_t length) const;
+        size_t decrypted_size(size_t length) const;
+        void encrypt(std::span<const std::byte> input, std::span<std::byte> output, std::span<const std::byte> associated_data = {}) const;
+        bool decrypt(std::span<const std::byte> input, std::span<std::byte> output, std::span<const std::byte> associated_data = {}) const;
+
+        // Потоковое шифрование и дешифрование файла кусками по stream_chunk_size байт
+        // Память ограничена тремя кусками независимо от размера файла, чтение и запись идут параллельно с шифрованием
+        // - is_hex: содержимое входного файла в hex-формате
+        cipher_stats encrypt_stream(const char* input_file_name, const char* output_file_name, bool is_hex = false) const { return process_stream(input_file_name, output_file_name, is_hex, false); }
+        cipher_stats decrypt_stream(const char* input_file_name, const char* output_file_name, bool is_hex = false) const { return process_stream(input_file_name, output_file_name, is_hex, true); }
+
+        // Шифрование и дешифрование файла, отображённого в память: без промежуточных буферов и копий в потоки
+        // Если output_file_name равен nullptr или совпадает с input_file_name, файл обрабатывается на месте
+        cipher_stats encrypt_mapped(const char* input_file_name, const char* output_file_name = nullptr) const { return process_mapped(input_file_name, output_file_name, false); }
+        cipher_stats decrypt_mapped(const char* input_file_name, const char* output_file_name = nullptr) const { return process_mapped(input_file_name, output_file_name, true); }
+
+        // Шифрование и дешифрование множества файлов: input_file_names[i] -> output_file_names[i]
+        // Рассчитано на сотни тысяч небольших файлов: открытие, чтение, шифрование и запись разных файлов
+        // идут одновременно. Ввод-вывод через io_uring, если ядро его поддерживает (use_io_uring = false —
+        // всегда потоки с pread/pwrite). При расшифровании stats.authentication_failures — число файлов, не
+        // прошедших проверку MGM (их выходные файлы удаляются)
+        cipher_stats encrypt_files(const std::vector<std::string>& input_file_names, const std::vector<std::string>& output_file_names, bool use_io_uring = true) const { return process_files(input_file_names, output_file_names, false, use_io_uring); }
+        cipher_stats decrypt_files(const std::vector<std::string>& input_file_names, const std::vector<std::string>& output_file_names, bool use_io_uring = true) const { return process_files(input_file_names, output_file_names, true, use_io_uring); }
+
         // Шифрование данных и запись в файл
-        void encrypt_data(const char* output_file_name, bool use_hex = false);
+        cipher_stats encrypt_data(const char* output_file_name, bool use_hex = false);
         // Дешифрование данных и запись в файл
-        void decrypt_data(const char* output_file_name, bool use_hex = false);
-};
\ No newline at end of file
+        cipher_stats decrypt_data(const char* output_file_name, bool use_hex = false);
+};
+
+// Цепочка ключей секций CTR-ACPKM принадлежит потоку, а не ключу: key_context остаётся неизменяемым,
+// разные потоки под одним ключом не делят ни блокировку, ни положение в цепочке
+// Хранит шифры секций последнего участка в кольце фиксированного размера (ключи — в самой цепочке, память
+// не выделяется); следующий участок продолжает цепочку с последней из них, участок раньше first_section
+// начинает её заново с исходного ключа
+struct acpkm_chain
+{
+    // Ячеек кольца: кусок потока (4 МБ) при секции по умолчанию (256 КБ) — ровно столько секций
+    static const size_t capacity = 16;
+
+    uint64_t first_section = 0; // Номер первой запомненной секции
+    size_t size = 0; // Запомнено секций: first_section, first_section + 1, …
+    std::optional<key_context> keys[capacity]; // Ключи секций, секция s — в ячейке s % capacity (у секции 0 — ключ объекта)
+    std::optional<kuznechik> ciphers[capacity]; // Шифры секций в тех же ячейках, ссылаются на keys без владения
+};
+
+// Преобразования шифра — constexpr, поэтому определены в заголовке: по ним при компиляции
+// строятся итерационные константы и таблицы L∘S
+
+
+// Получение значения маски для линейного преобразования
+constexpr unsigned char kuznechik::get_mask_value(int index)
+{
+    assert(index >= 0 && index < block::size && "Wrong index value"); // Проверка индекса
+    return mask[index]; // Возвращаем элемент из таблицы маски
+}
+
+// Получение значения из таблицы подстановки S
+constexpr unsigned char kuznechik::get_substituted_value(int index)
+{
+    assert(index >= 0 && index <= UCHAR_MAX && "Wrong index value"); // Проверка диапазона
+    return substitution_table[index]; // Возвращаем подстановку
+}
+
+// Получение значения из обратной таблицы подстановки S⁻¹
+constexpr unsigned char kuznechik::get_reversed_substituted_value(int index)
+{
+    assert(index >= 0 && index <= UCHAR_MAX && "Wrong index value"); // Проверка диапазона
+    return substitution_table_reversed[index]; // Возвращаем обратную подстановку
+}
+// Нелинейное преобразование S
+constexpr block kuznechik::S(const block& input_block)
+{
+    block transformed_block;
+    for (int i = 0; i < block::size; i++) // Для каждого байта блока
+        transformed_block.set(i, get_substituted_value(input_block[i])); // Применяем подстановку
+    return transformed_block; // Возвращаем преобразованный блок
+}
+
+// Обратное нелинейное преобразование S⁻¹
+constexpr block kuznechik::S_reversed(const block& input_block)
+{
+    block transformed_block;
+    for (int i = 0; i < block::size; i++) // Для каждого байта
+        transformed_block.set(i, get_reversed_substituted_value(input_block[i])); // Обратная подстановка
+    return transformed_block; // Возвращаем блок
+}
+
+// Умножение в поле Галуа GF(2^8) для линейного преобразования
+constexpr unsigned char kuznechik::GF_mul(unsigned char a, unsigned char b)
+{
+    unsigned char c = 0;
+    for (int i = 0; i < 8; i++) // 8 бит в байте
+    {
+        if ((b & 1) == 1) // Если младший бит b равен 1
+            c ^= a; // Добавляем a к результату
+        unsigned char hi_bit = (char)(a & 0x80); // Проверяем старший бит a
+        a <<= 1; // Сдвиг a влево
+        if (hi_bit == 0) // Если был перенос
+            a ^= 0xC3; // Применяем полином x^8 + x^7 + x^6 + x + 1
+        b >>= 1; // Сдвиг b вправо
+    }
+    return c; // Возвращаем произведение
+}
+
+// Внутреннее линейное преобразование R
+constexpr block kuznechik::R(const block& input_block)
+{
+    unsigned char transformed_data[block::size] = {}; // Новый блок
+    unsigned char trailing_symbol = 0; // Контрольная сумма
+    for (int i = block::size - 1; i >= 0; i--) // Сдвиг байтов вправо
+    {
+        if (i != 0) // Нулевой байт уходит из блока, его место занимает сумма
+            transformed_data[i - 1] = input_block[i]; // Сдвигаем
+        trailing_symbol ^= GF_mul(input_block[i], get_mask_value(i)); // Вычисляем сумму
+    }
+    transformed_data[block::size - 1] = trailing_symbol; // Вставляем сумму
+    return block(transformed_data);
+}
+
+// Обратное внутреннее линейное преобразование R⁻¹
+constexpr block kuznechik::R_reversed(const block& input_block)
+{
+    unsigned char transformed_data[block::size] = {}; // Новый блок
+    unsigned char leading_symbol = input_block[block::size - 1]; // Извлекаем сумму
+    for (int i = 1; i < block::size; i++) // Сдвиг влево
+    {
+        transformed_data[i] = input_block[i - 1]; // Сдвигаем байты
+        leading_symbol ^= GF_mul(transformed_data[i], get_mask_value(i)); // Обновляем сумму
+    }
+    transformed_data[0] = leading_symbol; // Вставляем результат
+    return block(transformed_data);
+}
+
+// Полное линейное преобразование L (16 итераций R)
+constexpr block kuznechik::L(const block& input_block)
+{
+    block transformed_block = input_block;
+    for (int i = 0; i < block::size; i++) // 16 итераций
+        transformed_block = R(transformed_block); // Применяем R
+    return transformed_block;
+}
+
+// Обратное линейное преобразование L⁻¹ (16 итераций R⁻¹)
+constexpr block kuznechik::L_reversed(const block& input_block)
+{
+    block transformed_block = input_block;
+    for (int i = 0; i < block::size; i++) // 16 итераций
+        transformed_block = R_reversed(transformed_block); // Применяем R⁻¹
+    return transformed_block;
+}
+
+// Функция Фейстеля для генерации ключей
+constexpr key_pair kuznechik::F(const key_pair& input_key_pair, const block& iteration_constant)
+{
+    block returned_key_1;
+    block returned_key_2 = input_key_pair.key_1; // Сохраняем первый ключ
+    returned_key_1 = L(S(input_key_pair.key_2 ^ iteration_constant)) ^ returned_key_2; // SP-сеть + XOR
+    return key_pair(returned_key_1, returned_key_2); // Возвращаем новую пару ключей
+}
@@ -0,0 +1,117 @@
+#include "kuznechik.h"
+
+// Раунд L∘S через таблицы: каждый байт даёт одну запись, записи складываются
+block kuznechik::ls_round(const block& input_block)
+{
+    uint64_t lo = input_block.low();
+    uint64_t hi = input_block.high();
+    block returned_block = ls_table[0][lo & 0xFF] ^ ls_table[8][hi & 0xFF];
+    for (int j = 1; j < 8; j++)
+        returned_block ^= ls_table[j][(lo >> (8 * j)) & 0xFF] ^ ls_table[j + 8][(hi >> (8 * j)) & 0xFF];
+    return returned_block;
+}
+
+// Развёртывание ключей пачками: F(k_1, k_2) = (LS(k_2 ^ C) ^ k_1, k_1), где LS — раунд из таблиц
+void kuznechik::expand_keys(const block keys_1[], const block keys_2[], size_t count, block iteration_keys[])
+{
+    const size_t lanes = 8; // Ключей, чьи сети Фейстеля чередуются
+    for (size_t first = 0; first < count; first += lanes)
+    {
+        const size_t width = std::min(lanes, count - first);
+        key_pair pairs[lanes];
+        for (size_t l = 0; l < width; l++)
+        {
+            pairs[l] = key_pair(keys_1[first + l], keys_2[first + l]);
+            iteration_keys[(first + l) * number_of_iteration_keys] = keys_1[first + l]; // Первый ключ
+            iteration_keys[(first + l) * number_of_iteration_keys + 1] = keys_2[first + l]; // Второй ключ
+        }
+        for (int c = 0; c < number_of_iteration_constants; c++) // 4 цикла по 8 итераций
+        {
+            for (size_t l = 0; l < width; l++)
+                pairs[l] = key_pair(ls_round(pairs[l].key_2 ^ iteration_constants[c]) ^ pairs[l].key_1, pairs[l].key_1);
+            if (c % 8 == 7) // Конец цикла: сохраняем пару ключей
+                for (size_t l = 0; l < width; l++)
+                {
+                    iteration_keys[(first + l) * number_of_iteration_keys + 2 * (c / 8) + 2] = pairs[l].key_1;
+                    iteration_keys[(first + l) * number_of_iteration_keys + 2 * (c / 8) + 3] = pairs[l].key_2;
+                }
+        }
+    }
+}
+
+// Пакетный CTR: гамма всех сообщений нумеруется сквозь пакет, group_size блоков подряд
+// (возможно, из разных сообщений) шифруются одним вызовом многоключевого ядра
+void kuznechik::ctr_crypt_batch(const batch_message messages[], size_t count, engine_type engine)
+{
+    if (count == 0)
+        return;
+
+    // Эталонный и битсрезовый движки не умеют брать свой ключ для каждого блока
+    if (engine != engine_type::table && engine != engine_type::simd)
+    {
+        thread_pool::global().parallel_for(count, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t m = begin; m < end; m++)
+            {
+                kuznechik cipher(std::make_shared<const key_context>(messages[m].key_1, messages[m].key_2));
+                cipher.set_engine(engine);
+                cipher.ctr_crypt(messages[m].input, messages[m].output, messages[m].length, messages[m].initialization_vector);
+            }
+        });
+        return;
+    }
+
+    // Ключи развёртываются кусками по 64 в потоках пула
+    std::vector<block> keys_1(count), keys_2(count);
+    for (size_t m = 0; m < count; m++)
+    {
+        keys_1[m] = messages[m].key_1;
+        keys_2[m] = messages[m].key_2;
+    }
+    std::vector<block> schedules(count * number_of_iteration_keys);
+    thread_pool::global().parallel_for(count, 64, [&](size_t begin, size_t end)
+    {
+        expand_keys(&keys_1[begin], &keys_2[begin], end - begin, &schedules[begin * number_of_iteration_keys]);
+    });
+
+    // first_block[m] — номер первого блока сообщения m в сквозной нумерации пакета
+    std::vector<size_t> first_block(count + 1, 0);
+    for (size_t m = 0; m < count; m++)
+        first_block[m + 1] = first_block[m] + (messages[m].length + block::size - 1) / block::size;
+
+    thread_pool::global().parallel_for(first_block[count], parallel_grain, [&](size_t begin, size_t end)
+    {
+        // Последнее сообщение, начинающееся не позже begin (пустые сообщения пропускаются)
+        size_t m = std::upper_bound(first_block.begin(), first_block.end(), begin) - first_block.begin() - 1;
+        for (size_t i = begin; i < end; i += group_size)
+        {
+            const size_t group_count = std::min((size_t)group_size, end - i);
+            block gamma[group_size];
+            const block* keys[group_size];
+            size_t group_messages[group_size];
+            for (size_t j = 0; j < group_count; j++)
+            {
+                while (first_block[m + 1] <= i + j)
+                    m++;
+                gamma[j] = block(i + j - first_block[m], messages[m].initialization_vector); // Счётчик CTR сообщения
+                keys[j] = &schedules[m * number_of_iteration_keys];
+                group_messages[j] = m;
+            }
+            if (engine == engine_type::simd)
+                encrypt_blocks_simd_multikey(ls_table.values, keys, gamma, group_count);
+            else
+                encrypt_blocks_generic_multikey(ls_table.values, keys, gamma, group_count);
+
+            for (size_t j = 0; j < group_count; j++)
+            {
+                const batch_message& message = messages[group_messages[j]];
+                const size_t offset = (i + j - first_block[group_messages[j]]) * block::size;
+                const size_t bytes = std::min((size_t)block::size, message.length - offset); // Последний блок может быть неполным
+                unsigned char gamma_bytes[block::size];
+                gamma[j].store(gamma_bytes);
+                for (size_t k = 0; k < bytes; k++)
+                    message.output[offset + k] = message.input[offset + k] ^ gamma_bytes[k];
+            }
+        }
+    });
+}
@@ -0,0 +1,146 @@
+#include "kuznechik_bitslice.h"
+#include <algorithm>
+
+// Транспонирование матрицы 64×64 бит: бит j слова i переходит в бит i слова j
+static void transpose64(uint64_t words[64])
+{
+    uint64_t mask = 0x00000000FFFFFFFFULL;
+    for (int width = 32; width != 0; width >>= 1, mask ^= mask << width)
+        for (int k = 0; k < 64; k = ((k | width) + 1) & ~width)
+        {
+            uint64_t t = ((words[k] >> width) ^ words[k | width]) & mask;
+            words[k] ^= t << width;
+            words[k | width] ^= t;
+        }
+}
+
+void build_bitslice_circuit(const unsigned char substitution_table[UCHAR_MAX + 1], const block linear_columns[], const block& linear_constant, bitslice_circuit& circuit)
+{
+    // АНФ каждого выходного бита S через преобразование Мёбиуса
+    for (int bit = 0; bit < 8; bit++)
+    {
+        unsigned char coefficients[UCHAR_MAX + 1];
+        for (int u = 0; u <= UCHAR_MAX; u++)
+            coefficients[u] = (substitution_table[u] >> bit) & 1;
+        for (int i = 0; i < 8; i++)
+            for (int u = 0; u <= UCHAR_MAX; u++)
+                if (u & (1 << i))
+                    coefficients[u] ^= coefficients[u ^ (1 << i)];
+        circuit.substitution_monomials[bit].clear();
+        for (int u = 0; u <= UCHAR_MAX; u++)
+            if (coefficients[u])
+                circuit.substitution_monomials[bit].push_back((uint8_t)u);
+    }
+
+    // Строки матрицы L: выходной бит r зависит от входного бита c, если бит r столбца c установлен
+    for (int r = 0; r < bitslice_circuit::block_bits; r++)
+    {
+        circuit.linear_inputs[r].clear();
+        for (int c = 0; c < bitslice_circuit::block_bits; c++)
+            if ((linear_columns[c][r / 8] >> (r % 8)) & 1)
+                circuit.linear_inputs[r].push_back((uint8_t)c);
+    }
+    circuit.linear_constant = linear_constant;
+}
+
+// XOR с ключом: каждый бит ключа растягивается на всё слово без ветвлений
+static void add_round_key(uint64_t slices[], const block& key)
+{
+    for (int c = 0; c < bitslice_circuit::block_bits; c++)
+        slices[c] ^= 0 - (uint64_t)((key[c / 8] >> (c % 8)) & 1);
+}
+
+// Нелинейное преобразование S для всех 16 байтов
+static void substitute(const bitslice_circuit& circuit, uint64_t slices[])
+{
+    uint64_t monomials[UCHAR_MAX + 1];
+    for (int j = 0; j < 16; j++)
+    {
+        uint64_t* x = slices + 8 * j; // 8 бит j-го байта
+        monomials[0] = ~0ULL;
+        for (int u = 1; u <= UCHAR_MAX; u++) // Моном u — произведение бит x_i для всех i из u
+            monomials[u] = monomials[u & (u - 1)] & x[__builtin_ctz(u)];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            uint64_t result = 0;
+            for (uint8_t u : circuit.substitution_monomials[bit])
+                result ^= monomials[u];
+            x[bit] = result;
+        }
+    }
+}
+
+// Линейное преобразование L
+static void linear(const bitslice_circuit& circuit, uint64_t slices[])
+{
+    uint64_t transformed[bitslice_circuit::block_bits];
+    for (int r = 0; r < bitslice_circuit::block_bits; r++)
+    {
+        uint64_t result = 0 - (uint64_t)((circuit.linear_constant[r / 8] >> (r % 8)) & 1);
+        for (uint8_t c : circuit.linear_inputs[r])
+            result ^= slices[c];
+        transformed[r] = result;
+    }
+    std::copy(transformed, transformed + bitslice_circuit::block_bits, slices);
+}
+
+// Переход к срезам: слова 0–63 — биты младшей половины блоков, 64–127 — старшей
+static void load_slices(const block blocks[], size_t batch, uint64_t slices[])
+{
+    for (size_t b = 0; b < 64; b++)
+    {
+        slices[b] = b < batch ? blocks[b].low() : 0;
+        slices[64 + b] = b < batch ? blocks[b].high() : 0;
+    }
+    transpose64(slices);
+    transpose64(slices + 64);
+}
+
+// Обратный переход к блокам
+static void store_slices(uint64_t slices[], block blocks[], size_t batch)
+{
+    transpose64(slices);
+    transpose64(slices + 64);
+    for (size_t b = 0; b < batch; b++)
+        blocks[b] = block(slices[b], slices[64 + b]);
+}
+
+void encrypt_blocks_bitsliced(const bitslice_circuit& circuit, const block keys[], block blocks[], size_t count)
+{
+    for (size_t n = 0; n < count; n += bitslice_circuit::batch_size)
+    {
+        size_t batch = std::min((size_t)bitslice_circuit::batch_size, count - n);
+        uint64_t slices[bitslice_circuit::block_bits];
+        load_slices(blocks + n, batch, slices);
+
+        for (int i = 0; i < 9; i++) // 9 раундов
+        {
+            add_round_key(slices, keys[i]);
+            substitute(circuit, slices);
+            linear(circuit, slices);
+        }
+        add_round_key(slices, keys[9]); // Финальный XOR
+
+        store_slices(slices, blocks + n, batch);
+    }
+}
+
+void decrypt_blocks_bitsliced(const bitslice_circuit& reversed_circuit, const block keys[], block blocks[], size_t count)
+{
+    for (size_t n = 0; n < count; n += bitslice_circuit::batch_size)
+    {
+        size_t batch = std::min((size_t)bitslice_circuit::batch_size, count - n);
+        uint64_t slices[bitslice_circuit::block_bits];
+        load_slices(blocks + n, batch, slices);
+
+        add_round_key(slices, keys[9]); // Убираем последний ключ
+        for (int i = 8; i >= 0; i--) // 9 раундов в обратном порядке
+        {
+            linear(reversed_circuit, slices);
+            substitute(reversed_circuit, slices);
+            add_round_key(slices, keys[i]);
+        }
+
+        store_slices(slices, blocks + n, batch);
+    }
+}
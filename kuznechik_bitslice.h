@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <vector>
+#include "kuznechik_block.h"
+
+// Битсрезовая (bitsliced) схема раунда "Кузнечика": 64 блока обрабатываются одновременно,
+// слово c хранит c-й бит всех 64 блоков. S вычисляется через алгебраическую нормальную форму,
+// L — через XOR входных бит по матрице, поэтому при шифровании блоков обращений к памяти, зависящих
+// от данных, нет. Развёртывание ключа, ключи секций ACPKM и подключ имитовставки по-прежнему
+// вычисляются табличным ядром, а ключи расшифрования — умножением в поле с ветвлениями
+struct bitslice_circuit
+{
+    static const int batch_size = 64; // Количество блоков в одной пачке (бит в слове)
+    static const int block_bits = 128; // Количество бит в блоке
+
+    std::vector<uint8_t> substitution_monomials[8]; // Мономы АНФ для каждого выходного бита S
+    std::vector<uint8_t> linear_inputs[block_bits]; // Входные биты, XOR которых даёт выходной бит L
+    block linear_constant; // L(0): L аффинно и константа добавляется отдельно
+};
+
+// Построение схемы по таблице подстановок и столбцам L
+// - linear_columns[c]: L(e_c) ^ L(0), где e_c — блок с единственным установленным битом c
+// - linear_constant: L(0)
+void build_bitslice_circuit(const unsigned char substitution_table[UCHAR_MAX + 1], const block linear_columns[], const block& linear_constant, bitslice_circuit& circuit);
+
+// Шифрование count блоков на месте пачками по 64 блока
+void encrypt_blocks_bitsliced(const bitslice_circuit& circuit, const block keys[], block blocks[], size_t count);
+// Дешифрование count блоков на месте схемой обратного раунда (S⁻¹ и L⁻¹): раунды идут в обратном
+// порядке, в каждом сначала L⁻¹, затем S⁻¹; keys — те же 10 итерационных ключей
+void decrypt_blocks_bitsliced(const bitslice_circuit& reversed_circuit, const block keys[], block blocks[], size_t count);
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Структура для представления 16-байтового блока данных (128 бит)
+// Байты хранятся в двух 64-битных словах (байты 0–7 и 8–15, младший байт первым): блок тривиально
+// копируется, не обращается к куче, а на x86 его представление в памяти совпадает с исходными байтами
+struct alignas(16) block
+{
+    public:
+        static const int size = 16; // Размер блока в байтах (фиксирован для "Кузнечика")
+
+        constexpr block() : words{0, 0} {} // Нулевой блок
+        constexpr block(uint64_t low_word, uint64_t high_word) : words{low_word, high_word} {} // Блок из двух слов
+        // Блок из 16 байтов памяти
+        constexpr explicit block(const unsigned char* bytes) : words{0, 0}
+        {
+            for (int i = 0; i < size; i++)
+                words[i / 8] |= (uint64_t)bytes[i] << (8 * (i % 8));
+        }
+        block(const std::vector<unsigned char>& input_string); // Конструктор из вектора байтов
+        block(const std::string& input_string); // Конструктор из строки
+
+        // Доступ к байту по индексу
+        constexpr unsigned char operator[](const int index) const
+        {
+            assert(index >= 0 && index < size && "given index causes overflow");
+            return (unsigned char)(words[index / 8] >> (8 * (index % 8)));
+        }
+        // Замена байта по индексу
+        constexpr void set(const int index, unsigned char value)
+        {
+            assert(index >= 0 && index < size && "given index causes overflow");
+            words[index / 8] &= ~((uint64_t)0xFF << (8 * (index % 8)));
+            words[index / 8] |= (uint64_t)value << (8 * (index % 8));
+        }
+
+        constexpr uint64_t low() const { return words[0]; } // Байты 0–7
+        constexpr uint64_t high() const { return words[1]; } // Байты 8–15
+
+        // Оператор XOR для блоков
+        friend constexpr block operator^(const block& a, const block& b) { return block(a.words[0] ^ b.words[0], a.words[1] ^ b.words[1]); }
+        constexpr block& operator^=(const block& b) { words[0] ^= b.words[0]; words[1] ^= b.words[1]; return *this; }
+        friend constexpr bool operator==(const block& a, const block& b) { return a.words[0] == b.words[0] && a.words[1] == b.words[1]; }
+        friend constexpr bool operator!=(const block& a, const block& b) { return !(a == b); }
+
+        void store(unsigned char* bytes) const; // Запись 16 байтов блока в память
+        std::string to_string() const; // Байты блока в виде строки
+        friend std::ostream& operator<<(std::ostream& os, const block& b); // Вывод блока в поток
+        void print() const; // Печать блока в консоль
+    private:
+        uint64_t words[2]; // Внутреннее хранение байтов блока
+};
+
+static_assert(std::is_trivially_copyable<block>::value, "block must be trivially copyable");
+static_assert(sizeof(block) == block::size && alignof(block) == block::size, "block must be 16 bytes aligned to 16");
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "kuznechik_container.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char container_magic[8] = {'K', 'U', 'Z', 'C', 'O', 'N', 'T', '1'};
+static const uint32_t container_version = 1;
+
+// Числа в заголовке и таблице хранятся little-endian независимо от процессора
+static void store_number(unsigned char* bytes, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++)
+        bytes[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint64_t load_number(const unsigned char* bytes, int size)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++)
+        value |= (uint64_t)bytes[i] << (8 * i);
+    return value;
+}
+
+// Чтение length байтов с offset целиком (pread может вернуть меньше запрошенного)
+static bool read_exactly(int descriptor, unsigned char* bytes, size_t length, uint64_t offset)
+{
+    while (length != 0)
+    {
+        ssize_t result = pread(descriptor, bytes, length, offset);
+        if (result <= 0)
+            return false;
+        bytes += result;
+        length -= result;
+        offset += result;
+    }
+    return true;
+}
+
+container_reader::container_reader(const char* file_name, std::shared_ptr<const key_context> key, engine_type engine) : cipher(std::move(key))
+{
+    cipher.set_engine(engine);
+    descriptor = open(file_name, O_RDONLY);
+    assert(descriptor >= 0 && "Can't find file");
+    unsigned char header[container_header_size];
+    bool complete = read_exactly(descriptor, header, container_header_size, 0);
+    assert(complete && memcmp(header, container_magic, sizeof(container_magic)) == 0 && "Wrong container");
+    assert(load_number(header + 8, 4) == container_version && "Unsupported container version");
+    chunk_length = load_number(header + 12, 4);
+    data_length = load_number(header + 16, 8);
+    number_of_chunks = load_number(header + 24, 8);
+    nonce = load_number(header + 32, 8);
+    index_offset = load_number(header + 48, 8);
+    assert(chunk_length != 0 && chunk_length % block::size == 0 && "Wrong container");
+    assert(number_of_chunks == (data_length + chunk_length - 1) / chunk_length && "Wrong container");
+    (void)complete;
+}
+
+container_reader::container_reader(const char* file_name, const block& key_1, const block& key_2, engine_type engine) : container_reader(file_name, key_cache::global().get(key_1, key_2), engine)
+{
+}
+
+container_reader::~container_reader()
+{
+    if (descriptor >= 0)
+        close(descriptor);
+}
+
+size_t container_reader::read(uint64_t offset, std::span<std::byte> output) const
+{
+    if (offset >= data_length || output.empty())
+        return 0;
+    const size_t length = (size_t)std::min<uint64_t>(output.size(), data_length - offset);
+    const uint64_t first_chunk = offset / chunk_length;
+    const uint64_t last_chunk = (offset + length - 1) / chunk_length;
+
+    // Записи таблицы только для затронутых кусков, одним чтением
+    const size_t number_of_entries = last_chunk - first_chunk + 1;
+    unsigned char stack_entries[64 * container_entry_size];
+    std::vector<unsigned char> heap_entries;
+    unsigned char* entries = stack_entries;
+    if (number_of_entries > 64)
+    {
+        heap_entries.resize(number_of_entries * container_entry_size);
+        entries = heap_entries.data();
+    }
+    bool complete = read_exactly(descriptor, entries, number_of_entries * container_entry_size, index_offset + first_chunk * container_entry_size);
+    assert(complete && "Damaged container");
+
+    // Из каждого куска читаются только байты участка и расшифровываются гаммой с их смещения в данных
+    unsigned char* bytes = (unsigned char*)output.data();
+    for (uint64_t chunk = first_chunk; chunk <= last_chunk; chunk++)
+    {
+        const unsigned char* entry = entries + (chunk - first_chunk) * container_entry_size;
+        const uint64_t chunk_offset = load_number(entry, 8);
+        const uint64_t stored_length = load_number(entry + 8, 4);
+        const uint64_t chunk_begin = chunk * chunk_length; // Смещение куска в исходных данных
+        const uint64_t begin = std::max(offset, chunk_begin);
+        const uint64_t end = std::min(offset + length, chunk_begin + stored_length);
+        assert(end == std::min(offset + length, chunk_begin + chunk_length) && "Damaged container");
+        complete = read_exactly(descriptor, bytes + (begin - offset), end - begin, chunk_offset + (begin - chunk_begin));
+        assert(complete && "Damaged container");
+        cipher.ctr_crypt(bytes + (begin - offset), bytes + (begin - offset), end - begin, nonce, begin);
+    }
+    (void)complete;
+    return length;
+}
+
+cipher_stats encrypt_container(const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine, const block& initialization_vector)
+{
+    cipher_stats stats;
+    stats_scope scope(stats);
+    stats.files = 1;
+    double start = omp_get_wtime();
+    kuznechik cipher{block(key_1), block(key_2)};
+    cipher.set_engine(engine);
+    stats.key_time = omp_get_wtime() - start;
+
+    std::ifstream input_stream(input_file_name, std::ios::binary);
+    assert(input_stream && "Can't find file");
+    input_stream.seekg(0, std::ios::end);
+    const uint64_t length = input_stream.tellg();
+    input_stream.seekg(0, std::ios::beg);
+    const uint64_t number_of_chunks = (length + container_chunk_size - 1) / container_chunk_size;
+
+    std::ofstream output_stream(output_file_name, std::ios::binary);
+    assert(output_stream.is_open() && "Can't open file");
+
+    // Заголовок и таблица известны заранее: куски идут подряд за таблицей
+    start = omp_get_wtime();
+    unsigned char header[container_header_size] = {};
+    memcpy(header, container_magic, sizeof(container_magic));
+    store_number(header + 8, container_version, 4);
+    store_number(header + 12, container_chunk_size, 4);
+    store_number(header + 16, length, 8);
+    store_number(header + 24, number_of_chunks, 8);
+    initialization_vector.store(header + 32);
+    store_number(header + 48, container_header_size, 8);
+    output_stream.write((const char*)header, container_header_size);
+    const uint64_t data_offset = container_header_size + number_of_chunks * container_entry_size;
+    std::vector<unsigned char> index(std::min<uint64_t>(number_of_chunks, container_chunk_size / container_entry_size) * container_entry_size);
+    for (uint64_t chunk = 0; chunk < number_of_chunks;)
+    {
+        size_t count = std::min<uint64_t>(number_of_chunks - chunk, index.size() / container_entry_size);
+        for (size_t i = 0; i < count; i++, chunk++)
+        {
+            memset(index.data() + i * container_entry_size, 0, container_entry_size);
+            store_number(index.data() + i * container_entry_size, data_offset + chunk * container_chunk_size, 8);
+            store_number(index.data() + i * container_entry_size + 8, std::min<uint64_t>(container_chunk_size, length - chunk * container_chunk_size), 4);
+        }
+        output_stream.write((const char*)index.data(), count * container_entry_size);
+    }
+    stats.write_time += omp_get_wtime() - start;
+
+    std::vector<unsigned char> chunk_bytes(container_chunk_size);
+    const uint64_t nonce = initialization_vector.low();
+    std::vector<uint64_t> items = thread_pool::global().processed_items();
+    for (uint64_t position = 0; position < length; position += container_chunk_size)
+    {
+        const size_t chunk_size = std::min<uint64_t>(container_chunk_size, length - position);
+        start = omp_get_wtime();
+        input_stream.read((char*)chunk_bytes.data(), chunk_size);
+        assert((size_t)input_stream.gcount() == chunk_size && "Can't read file");
+        stats.read_time += omp_get_wtime() - start;
+        start = omp_get_wtime();
+        cipher.ctr_crypt(chunk_bytes.data(), chunk_bytes.data(), chunk_size, nonce, position);
+        stats.cipher_time += omp_get_wtime() - start;
+        start = omp_get_wtime();
+        output_stream.write((const char*)chunk_bytes.data(), chunk_size);
+        stats.write_time += omp_get_wtime() - start;
+    }
+    output_stream.close();
+    stats.add_thread_blocks(items);
+    stats.bytes = length;
+    scope.finish();
+    return stats;
+}
+
+cipher_stats decrypt_container(const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine)
+{
+    cipher_stats stats;
+    stats_scope scope(stats);
+    stats.files = 1;
+    double start = omp_get_wtime();
+    container_reader reader(input_file_name, block(key_1), block(key_2), engine);
+    stats.key_time = omp_get_wtime() - start;
+    std::ofstream output_stream(output_file_name, std::ios::binary);
+    assert(output_stream.is_open() && "Can't open file");
+
+    // Куски читаются по одному: чтение и расшифрование идут вместе в read
+    std::vector<std::byte> chunk_bytes(reader.chunk_size());
+    std::vector<uint64_t> items = thread_pool::global().processed_items();
+    for (uint64_t position = 0; position < reader.length(); position += reader.chunk_size())
+    {
+        start = omp_get_wtime();
+        const size_t chunk_size = reader.read(position, chunk_bytes);
+        stats.cipher_time += omp_get_wtime() - start;
+        start = omp_get_wtime();
+        output_stream.write((const char*)chunk_bytes.data(), chunk_size);
+        stats.write_time += omp_get_wtime() - start;
+    }
+    output_stream.close();
+    stats.add_thread_blocks(items);
+    stats.bytes = reader.length();
+    scope.finish();
+    return stats;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "kuznechik.h"
+
+// Контейнер с произвольным доступом: данные шифруются в режиме CTR кусками по container_chunk_size байтов,
+// перед ними — заголовок и таблица кусков. Любой участок исходных данных расшифровывается чтением только
+// нужных записей таблицы и нужных байтов кусков, без расшифрования остального файла
+//
+// Формат (числа little-endian):
+// - заголовок, 64 байта: "KUZCONT1", версия (4 байта), размер куска (4), длина исходных данных (8),
+//   число кусков (8), синхропосылка (16, гамма CTR — от её младших 8 байтов), смещение таблицы (8), резерв (8)
+// - таблица: на кусок 16 байтов — смещение куска в файле (8), длина куска (4), резерв (4)
+// - куски: байты куска i — шифртекст исходных байтов [i * размер куска, (i + 1) * размер куска),
+//   гамма продолжается сквозь куски, поэтому каждый байт расшифровывается независимо по своему смещению
+// Контейнер не аутентифицирован: целостность обеспечивает MGM, у которого имитовставка одна на весь файл
+
+const size_t container_chunk_size = 1 << 20;
+const size_t container_header_size = 64;
+const size_t container_entry_size = 16;
+
+// Чтение контейнера: участки исходных данных по смещению, чтения из нескольких потоков допустимы
+class container_reader
+{
+    public:
+        container_reader(const char* file_name, std::shared_ptr<const key_context> key, engine_type engine = engine_type::table);
+        // Ключ развёртывается через общий кэш key_cache::global()
+        container_reader(const char* file_name, const block& key_1, const block& key_2, engine_type engine = engine_type::table);
+        ~container_reader();
+        container_reader(const container_reader&) = delete;
+        container_reader& operator=(const container_reader&) = delete;
+
+        // Длина исходных данных
+        uint64_t length() const { return data_length; }
+        // Размер куска и число кусков
+        size_t chunk_size() const { return chunk_length; }
+        uint64_t chunk_count() const { return number_of_chunks; }
+
+        // Расшифрование участка [offset, offset + output.size()) исходных данных в output
+        // Возвращает число расшифрованных байтов: меньше output.size(), если участок выходит за конец данных
+        size_t read(uint64_t offset, std::span<std::byte> output) const;
+
+    private:
+        kuznechik cipher; // Ключ и способ шифрования гаммы
+        int descriptor = -1;
+        uint64_t data_length = 0;
+        size_t chunk_length = 0;
+        uint64_t number_of_chunks = 0;
+        uint64_t index_offset = 0; // Смещение таблицы кусков в файле
+        uint64_t nonce = 0; // Младшие 8 байтов синхропосылки
+};
+
+// Запись контейнера из файла: input_file_name целиком, кусками по container_chunk_size
+// - initialization_vector: синхропосылка (сохраняется в заголовке, для расшифрования нужен только ключ)
+cipher_stats encrypt_container(const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine = engine_type::table, const block& initialization_vector = block());
+// Расшифрование всего контейнера в файл
+cipher_stats decrypt_container(const char* input_file_name, const char* output_file_name, const char* key_1, const char* key_2, engine_type engine = engine_type::table);
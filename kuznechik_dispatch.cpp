@@ -0,0 +1,234 @@
+#include "kuznechik_dispatch.h"
+#include <cmath>
+#include <unistd.h>
+
+static const char* const profile_magic = "kuznechik-dispatch";
+static const int profile_version = 1;
+static const char* const engine_names[] = {"reference", "table", "simd", "bitsliced"};
+
+// Время одного вызова run() в наносекундах: повторы, пока замер не займёт хотя бы minimum_time секунд,
+// из трёх замеров берётся наименьший (меньше всего помех)
+template <typename F>
+static double measure_ns(F run, double minimum_time = 20e-6)
+{
+    double best = INFINITY;
+    for (int attempt = 0; attempt < 3; attempt++)
+    {
+        for (uint64_t iterations = 1;; iterations *= 2)
+        {
+            double start = omp_get_wtime();
+            for (uint64_t i = 0; i < iterations; i++)
+                run();
+            double elapsed = omp_get_wtime() - start;
+            if (elapsed >= minimum_time)
+            {
+                best = std::min(best, elapsed / iterations * 1e9);
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+dispatch_profile& dispatch_profile::global()
+{
+    static dispatch_profile profile;
+    return profile;
+}
+
+dispatch_profile::dispatch_profile() : isa(get_simd_isa())
+{
+    for (int e = 0; e < number_of_engines; e++)
+    {
+        values.batch_blocks[e] = values.block_ns[e] = -1;
+        batch_threshold[e] = 0;
+        batch_isa[e] = -1;
+        serial_threshold[e] = 0;
+        serial_threads[e] = 0;
+    }
+    values.wake_ns = -1;
+    values.wake_threads = 0;
+}
+
+void dispatch_profile::set_file(const char* new_file_name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    file_name = new_file_name;
+    load();
+}
+
+size_t dispatch_profile::batch_blocks(engine_type engine) const
+{
+    if (batch_isa[(int)engine].load(std::memory_order_acquire) != (int)get_simd_isa())
+        return 0;
+    return batch_threshold[(int)engine].load(std::memory_order_relaxed);
+}
+
+size_t dispatch_profile::serial_blocks(engine_type engine, int threads) const
+{
+    if (serial_threads[(int)engine].load(std::memory_order_acquire) != threads)
+        return 0;
+    return serial_threshold[(int)engine].load(std::memory_order_relaxed);
+}
+
+void dispatch_profile::prepare(engine_type engine)
+{
+    const int e = (int)engine;
+    const simd_isa current_isa = get_simd_isa();
+    const bool inside_pool = thread_pool::in_parallel_region();
+    const int threads = inside_pool ? 0 : thread_pool::global().size();
+    const bool batch_ready = batch_isa[e].load(std::memory_order_acquire) == (int)current_isa;
+    const bool serial_ready = inside_pool || threads == 1 || serial_threads[e].load(std::memory_order_acquire) == threads;
+    if (batch_ready && serial_ready)
+        return;
+
+    // Недостающие значения берутся из профиля (файла или прошлых замеров), остальные измеряются
+    // без блокировки: замер пробуждения ждёт пул, а работающие в пуле потоки могут вызывать prepare
+    measurements known;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (isa != current_isa)
+        {
+            isa = current_isa;
+            for (int i = 0; i < number_of_engines; i++)
+                values.batch_blocks[i] = values.block_ns[i] = -1;
+        }
+        known = values;
+    }
+    measurements measured = known;
+    const bool measure_batch = known.batch_blocks[e] < 0;
+    const bool measure_block = !serial_ready && known.block_ns[e] < 0;
+    const bool measure_wake = !serial_ready && (known.wake_ns < 0 || known.wake_threads != threads);
+    if (measure_batch)
+        measured.batch_blocks[e] = measure_batch_blocks(engine);
+    if (measure_block)
+        measured.block_ns[e] = measure_block_ns(engine);
+    if (measure_wake)
+    {
+        measured.wake_ns = measure_wake_ns();
+        measured.wake_threads = threads;
+    }
+    if (measure_batch || measure_block || measure_wake)
+    {
+        // Записываются только свои замеры: другой поток мог тем временем измерить остальное
+        std::lock_guard<std::mutex> lock(mutex);
+        if (isa == current_isa)
+        {
+            if (measure_batch)
+                values.batch_blocks[e] = measured.batch_blocks[e];
+            if (measure_block)
+                values.block_ns[e] = measured.block_ns[e];
+            if (measure_wake)
+            {
+                values.wake_ns = measured.wake_ns;
+                values.wake_threads = measured.wake_threads;
+            }
+            save();
+        }
+    }
+
+    batch_threshold[e].store((size_t)measured.batch_blocks[e], std::memory_order_relaxed);
+    batch_isa[e].store((int)current_isa, std::memory_order_release);
+    if (!serial_ready)
+    {
+        // Параллельно: wake + T / threads, последовательно: T. Потоки выигрывают при T > wake * threads / (threads - 1)
+        const double serial_ns = measured.wake_ns * threads / (threads - 1);
+        serial_threshold[e].store((size_t)std::min(serial_ns / measured.block_ns[e], (double)(SIZE_MAX / 2)), std::memory_order_relaxed);
+        serial_threads[e].store(threads, std::memory_order_release);
+    }
+}
+
+// Неполная группа из count блоков: табличный движок против векторного на 1, 2, 4, ... блоках;
+// порог — наименьшее число блоков, на котором векторный уже не медленнее
+double dispatch_profile::measure_batch_blocks(engine_type engine)
+{
+    const int group_size = kuznechik::group_size;
+    if (engine != engine_type::simd)
+        return 0;
+    kuznechik cipher(std::make_shared<const key_context>(block(0x0123456789abcdef, 0), block(0, 0xfedcba9876543210)));
+    block blocks[group_size] = {};
+    cipher.encrypt_blocks_engine(engine, blocks, 1);
+    for (int count = 1; count < group_size; count *= 2)
+    {
+        const double table_ns = measure_ns([&] { cipher.encrypt_blocks_engine(engine_type::table, blocks, count); });
+        const double engine_ns = measure_ns([&] { cipher.encrypt_blocks_engine(engine, blocks, count); });
+        if (engine_ns <= table_ns)
+            return count;
+    }
+    return group_size;
+}
+
+// Время блока в полной группе (эталонный движок — по нескольким блокам, он в сотни раз медленнее)
+double dispatch_profile::measure_block_ns(engine_type engine)
+{
+    const int count = engine == engine_type::reference ? 4 : kuznechik::group_size;
+    kuznechik cipher(std::make_shared<const key_context>(block(0x0123456789abcdef, 0), block(0, 0xfedcba9876543210)));
+    block blocks[kuznechik::group_size] = {};
+    cipher.encrypt_blocks_engine(engine, blocks, count);
+    return measure_ns([&] { cipher.encrypt_blocks_engine(engine, blocks, count); }, 200e-6) / count;
+}
+
+// Пустой parallel_for по куску на поток: пробуждение фоновых потоков и ожидание их завершения
+double dispatch_profile::measure_wake_ns()
+{
+    thread_pool& pool = thread_pool::global();
+    const size_t count = pool.size();
+    pool.parallel_for(count, 1, [](size_t, size_t) {}); // Создание потоков до замера
+    return measure_ns([&] { pool.parallel_for(count, 1, [](size_t, size_t) {}); }, 1e-3);
+}
+
+void dispatch_profile::load()
+{
+    std::ifstream input_stream(file_name);
+    std::string magic;
+    int version = 0;
+    if (!(input_stream >> magic >> version) || magic != profile_magic || version != profile_version)
+        return;
+    measurements loaded = values;
+    std::string profile_isa;
+    for (std::string field; input_stream >> field;)
+    {
+        if (field == "isa")
+            input_stream >> profile_isa;
+        else if (field == "wake_ns")
+            input_stream >> loaded.wake_threads >> loaded.wake_ns;
+        else
+            for (int e = 0; e < number_of_engines; e++)
+            {
+                if (field == std::string("batch_blocks_") + engine_names[e])
+                    input_stream >> loaded.batch_blocks[e];
+                else if (field == std::string("block_ns_") + engine_names[e])
+                    input_stream >> loaded.block_ns[e];
+            }
+    }
+    // Профиль с другим набором инструкций не подходит: пороги будут измерены заново и перезапишут его
+    if (input_stream.bad() || profile_isa != simd_isa_name(get_simd_isa()))
+        return;
+    isa = get_simd_isa();
+    values = loaded;
+}
+
+void dispatch_profile::save() const
+{
+    if (file_name.empty())
+        return;
+    // Запись через временный файл: параллельно запущенные процессы (--shards) не прочитают недописанный профиль
+    const std::string temporary_name = file_name + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream output_stream(temporary_name);
+        if (!output_stream)
+            return; // Профиль — только ускорение: без него пороги измеряются при каждом запуске
+        output_stream << profile_magic << " " << profile_version << "\n";
+        output_stream << "isa " << simd_isa_name(isa) << "\n";
+        for (int e = 0; e < number_of_engines; e++)
+        {
+            if (values.batch_blocks[e] >= 0)
+                output_stream << "batch_blocks_" << engine_names[e] << " " << values.batch_blocks[e] << "\n";
+            if (values.block_ns[e] >= 0)
+                output_stream << "block_ns_" << engine_names[e] << " " << values.block_ns[e] << "\n";
+        }
+        if (values.wake_ns >= 0)
+            output_stream << "wake_ns " << values.wake_threads << " " << values.wake_ns << "\n";
+    }
+    std::rename(temporary_name.c_str(), file_name.c_str());
+}
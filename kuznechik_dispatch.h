@@ -0,0 +1,69 @@
+#pragma once
+#include "kuznechik.h"
+
+// Выбор пути выполнения по размеру данных: несколько блоков по таблицам, пачка векторным движком,
+// куски в пуле потоков. Пороги зависят от процессора и числа потоков, поэтому измеряются один раз на
+// процесс (короткие замеры, доли миллисекунды) или читаются из сохранённого профиля
+//
+// - batch_blocks(engine): с какого числа блоков неполная группа выгоднее векторному движку, чем табличному;
+//   меньше — kuznechik::encrypt_blocks и decrypt_blocks идут по таблицам (для остальных движков 0)
+// - serial_blocks(engine): до какого числа блоков пробуждение пула дороже, чем шифрование в одном потоке
+//   (время пробуждения и время блока движка измеряются, порог — где потоки начинают выигрывать)
+//
+// Пороги вычисляются в prepare (kuznechik вызывает его при выборе движка) и хранятся в атомарных
+// переменных: batch_blocks и serial_blocks вызываются на каждую пачку блоков, в том числе из потоков
+// пула, поэтому ничего не блокируют и ничего не измеряют. До prepare оба порога нулевые (движок не
+// подменяется, пул делит всё, что больше одного куска)
+//
+// Профиль — текстовый файл (kuznechik-dispatch 1, затем строки «имя значение»), действителен для того же
+// набора инструкций; время пробуждения хранится вместе с числом потоков, для которого измерено
+class dispatch_profile
+{
+    public:
+        // Общий профиль процесса
+        static dispatch_profile& global();
+
+        // Файл профиля: если он есть и снят на этом наборе инструкций, пороги берутся из него,
+        // иначе измеренные пороги записываются в него по мере измерения
+        void set_file(const char* file_name);
+
+        // Вычисление порогов engine для текущего набора инструкций и числа потоков пула, если их ещё нет
+        // Внутри parallel_for пробуждение пула не измерить (вложенный вызов последователен): там
+        // вычисляется только batch_blocks, serial_blocks — при следующем вызове вне пула
+        void prepare(engine_type engine);
+
+        size_t batch_blocks(engine_type engine) const;
+        size_t serial_blocks(engine_type engine, int threads) const;
+
+    private:
+        static const int number_of_engines = 4;
+
+        // Замеры (отрицательное значение — ещё не измерено)
+        struct measurements
+        {
+            double batch_blocks[number_of_engines];
+            double block_ns[number_of_engines]; // Время одного блока в пачке, в наносекундах
+            double wake_ns; // Время пустого parallel_for на всех потоках
+            int wake_threads; // Число потоков, для которого измерено wake_ns
+        };
+
+        dispatch_profile();
+        // Замеры без блокировки профиля: пробуждение измеряется через пул, а потоки пула обращаются к профилю
+        static double measure_batch_blocks(engine_type engine);
+        static double measure_block_ns(engine_type engine);
+        static double measure_wake_ns();
+        void load();
+        void save() const;
+
+        std::mutex mutex; // Замеры, файл и набор инструкций; при вызовах пула не удерживается
+        std::string file_name;
+        simd_isa isa;
+        measurements values;
+
+        // Вычисленные пороги: batch_isa — набор инструкций, для которого вычислен batch_threshold (-1 — нет),
+        // serial_threads — число потоков, для которого вычислен serial_threshold (0 — нет)
+        std::atomic<size_t> batch_threshold[number_of_engines];
+        std::atomic<int> batch_isa[number_of_engines];
+        std::atomic<size_t> serial_threshold[number_of_engines];
+        std::atomic<int> serial_threads[number_of_engines];
+};
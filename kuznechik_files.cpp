@@ -0,0 +1,196 @@
+#include "kuznechik.h"
+#include "kuznechik_io.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Файл пакета, находящийся в обработке: целиком читается в буфер, шифруется на месте и записывается
+struct batch_file
+{
+    size_t index; // Номер файла в списке
+    int input_descriptor;
+    int output_descriptor;
+    size_t length; // Длина входного файла
+    size_t done; // Прочитано или записано байтов
+    size_t output_length; // Длина результата (с дополнением или имитовставкой)
+    bool failed; // MGM: имитовставка не сошлась
+    int thread; // Поток пула, шифровавший файл (для статистики)
+    std::vector<unsigned char> bytes;
+};
+
+// Зашифрование или расшифрование файла, прочитанного в буфер, тем же способом, что и process_stream
+// Буфер вмещает дополнение и имитовставку, поэтому файл обрабатывается в нём на месте
+void kuznechik::process_file_bytes(batch_file& file, bool decrypt) const
+{
+    file.thread = thread_pool::current_thread_index();
+    const std::span<std::byte> bytes((std::byte*)file.bytes.data(), file.bytes.size());
+    if (!decrypt)
+    {
+        encrypt(bytes.first(file.length), bytes);
+        file.output_length = encrypted_size(file.length);
+        return;
+    }
+    file.failed = !this->decrypt(bytes.first(file.length), bytes);
+    file.output_length = decrypted_size(file.length);
+}
+
+cipher_stats kuznechik::process_files(const std::vector<std::string>& input_file_names, const std::vector<std::string>& output_file_names, bool decrypt, bool use_io_uring) const
+{
+    assert(input_file_names.size() == output_file_names.size() && "Each input file needs an output file");
+    cipher_stats stats;
+    stats_scope scope(stats);
+    const size_t number_of_files = input_file_names.size();
+    io_queue queue(batch_files_in_flight, use_io_uring);
+
+    // Ячейки файлов в обработке; метка операции — номер ячейки и признак записи в младшем бите
+    std::vector<batch_file> slots(batch_files_in_flight);
+    std::vector<size_t> free_slots;
+    for (size_t s = batch_files_in_flight; s-- > 0;)
+        free_slots.push_back(s);
+    std::vector<size_t> ready; // Прочитанные файлы, ждущие шифрования
+    std::vector<size_t> large_files; // Файлы больше batch_file_size_limit: обрабатываются потоково
+    std::vector<io_completion> completions;
+    size_t buffered_bytes = 0; // Память под буферы файлов в обработке
+    size_t reads_in_flight = 0; // Для статистики: ожидание с незавершённым чтением считается чтением, иначе записью
+
+    auto finish = [&](size_t s)
+    {
+        batch_file& file = slots[s];
+        close(file.input_descriptor);
+        close(file.output_descriptor);
+        if (file.failed)
+        {
+            std::remove(output_file_names[file.index].c_str());
+            stats.authentication_failures++;
+        }
+        buffered_bytes -= file.bytes.size();
+        std::vector<unsigned char>().swap(file.bytes);
+        free_slots.push_back(s);
+    };
+
+    size_t next_file = 0;
+    while (true)
+    {
+        double start = omp_get_wtime();
+        // Открываем следующие файлы и ставим их чтение, пока есть ячейки и память
+        while (!free_slots.empty() && next_file < number_of_files && (buffered_bytes < batch_memory_limit || buffered_bytes == 0))
+        {
+            const size_t index = next_file++;
+            int input_descriptor = open(input_file_names[index].c_str(), O_RDONLY);
+            assert(input_descriptor >= 0 && "Can't find file");
+            struct stat input_status;
+            fstat(input_descriptor, &input_status);
+            const size_t length = input_status.st_size;
+            if (length > batch_file_size_limit)
+            {
+                close(input_descriptor);
+                large_files.push_back(index);
+                continue;
+            }
+            int output_descriptor = open(output_file_names[index].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            assert(output_descriptor >= 0 && "Can't open file");
+
+            const size_t s = free_slots.back();
+            free_slots.pop_back();
+            batch_file& file = slots[s];
+            file.index = index;
+            file.input_descriptor = input_descriptor;
+            file.output_descriptor = output_descriptor;
+            file.length = length;
+            file.done = 0;
+            file.failed = false;
+            // Место под дополнение последнего блока и имитовставку MGM
+            file.bytes.resize((length + block::size - 1) / block::size * block::size + block::size);
+            buffered_bytes += file.bytes.size();
+            if (length == 0)
+                ready.push_back(s);
+            else
+            {
+                queue.read(input_descriptor, file.bytes.data(), length, 0, s << 1);
+                reads_in_flight++;
+            }
+        }
+        // Ядро читает следующие файлы, пока шифруются уже прочитанные
+        queue.submit();
+        stats.read_time += omp_get_wtime() - start;
+
+        if (!ready.empty())
+        {
+            // Файлы распределяются между потоками целиком, каждый шифруется в своём потоке последовательно
+            start = omp_get_wtime();
+            thread_pool::global().parallel_for(ready.size(), 1, [&](size_t begin, size_t end)
+            {
+                for (size_t r = begin; r < end; r++)
+                    process_file_bytes(slots[ready[r]], decrypt);
+            });
+            stats.cipher_time += omp_get_wtime() - start;
+            for (size_t s : ready)
+            {
+                batch_file& file = slots[s];
+                const size_t data_length = mode == cipher_mode::mgm && decrypt ? (file.length >= block::size ? file.length - block::size : 0) : file.length;
+                stats.bytes += data_length;
+                stats.files++;
+                stats.add_thread_blocks(file.thread, (data_length + block::size - 1) / block::size);
+                file.done = 0;
+                if (file.failed || file.output_length == 0)
+                    finish(s);
+                else
+                    queue.write(file.output_descriptor, file.bytes.data(), file.output_length, 0, s << 1 | 1);
+            }
+            ready.clear();
+            queue.submit();
+            continue;
+        }
+
+        if (queue.pending() == 0)
+        {
+            if (next_file == number_of_files)
+                break;
+            continue;
+        }
+        completions.clear();
+        start = omp_get_wtime();
+        queue.wait(completions);
+        (reads_in_flight != 0 ? stats.read_time : stats.write_time) += omp_get_wtime() - start;
+        for (const io_completion& completion : completions)
+        {
+            const size_t s = completion.tag >> 1;
+            const bool is_write = (completion.tag & 1) != 0;
+            batch_file& file = slots[s];
+            assert(completion.result >= 0 && (is_write ? "Can't write file" : "Can't read file"));
+            file.done += completion.result;
+            if (is_write)
+            {
+                // Неполная запись продолжается с места остановки
+                if (file.done < file.output_length)
+                    queue.write(file.output_descriptor, file.bytes.data() + file.done, file.output_length - file.done, file.done, s << 1 | 1);
+                else
+                    finish(s);
+                continue;
+            }
+            // Неполное чтение продолжается; конец файла раньше ожидаемого — файл укоротился после fstat
+            reads_in_flight--;
+            if (completion.result == 0)
+                file.length = file.done;
+            if (file.done < file.length)
+            {
+                queue.read(file.input_descriptor, file.bytes.data() + file.done, file.length - file.done, file.done, s << 1);
+                reads_in_flight++;
+            }
+            else
+                ready.push_back(s);
+        }
+    }
+
+    for (size_t index : large_files)
+    {
+        // Общее время и счётчики процессора уже идут во внешнем замере
+        cipher_stats file_stats = process_stream(input_file_names[index].c_str(), output_file_names[index].c_str(), false, decrypt);
+        file_stats.total_time = 0;
+        file_stats.counters = hardware_counters();
+        stats += file_stats;
+    }
+    stats.authentic = stats.authentication_failures == 0;
+    scope.finish();
+    return stats;
+}
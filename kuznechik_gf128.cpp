@@ -0,0 +1,132 @@
+#include "kuznechik_gf128.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define KUZNECHIK_X86_CLMUL
+#include <immintrin.h>
+#endif
+
+// Неприведённая сумма произведений: 256 бит, z[0] — младшее слово
+struct gf128_wide
+{
+    uint64_t z[4] = {0, 0, 0, 0};
+};
+
+// Приведение по модулю x^128 + x^7 + x^2 + x + 1: x^128 ≡ x^7 + x^2 + x + 1,
+// старшие 128 бит умножаются на 0x87 и складываются с младшими (слово z[3], затем z[2])
+static block gf128_reduce(gf128_wide wide)
+{
+    uint64_t* z = wide.z;
+    z[1] ^= z[3] ^ (z[3] << 1) ^ (z[3] << 2) ^ (z[3] << 7);
+    z[2] ^= (z[3] >> 63) ^ (z[3] >> 62) ^ (z[3] >> 57);
+    z[0] ^= z[2] ^ (z[2] << 1) ^ (z[2] << 2) ^ (z[2] << 7);
+    z[1] ^= (z[2] >> 63) ^ (z[2] >> 62) ^ (z[2] >> 57);
+    return block(z[0], z[1]);
+}
+
+// Младшие 64 бита произведения без переносов: биты множителей разбиты на 4 прореженные группы,
+// «дыры» между битами поглощают переносы целочисленного умножения, лишние биты затем маскируются
+static inline uint64_t clmul_low(uint64_t x, uint64_t y)
+{
+    const uint64_t m0 = 0x1111111111111111, m1 = 0x2222222222222222, m2 = 0x4444444444444444, m3 = 0x8888888888888888;
+    uint64_t x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+    uint64_t y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+    uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+    return (z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3);
+}
+
+// Разворот порядка бит в слове
+static inline uint64_t reverse_bits(uint64_t x)
+{
+    x = ((x >> 1) & 0x5555555555555555) | ((x & 0x5555555555555555) << 1);
+    x = ((x >> 2) & 0x3333333333333333) | ((x & 0x3333333333333333) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0F) | ((x & 0x0F0F0F0F0F0F0F0F) << 4);
+    return __builtin_bswap64(x);
+}
+
+// Произведение 64×64 -> 128 без переносов: старшая половина — младшая половина произведения
+// развёрнутых множителей, развёрнутая обратно
+static inline void clmul_64(uint64_t x, uint64_t y, uint64_t& high, uint64_t& low)
+{
+    low = clmul_low(x, y);
+    high = reverse_bits(clmul_low(reverse_bits(x), reverse_bits(y))) >> 1;
+}
+
+block gf128_multiply_sum_generic(const block a[], const block b[], size_t count)
+{
+    // Карацуба: a·b = a1·b1·x^128 ⊕ ((a0⊕a1)·(b0⊕b1) ⊕ a0·b0 ⊕ a1·b1)·x^64 ⊕ a0·b0,
+    // три произведения копятся по отдельности и собираются один раз
+    uint64_t low[2] = {0, 0}, high[2] = {0, 0}, middle[2] = {0, 0};
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t a1 = a[i].high(), a0 = a[i].low();
+        uint64_t b1 = b[i].high(), b0 = b[i].low();
+        uint64_t h, l;
+        clmul_64(a0, b0, h, l);
+        low[0] ^= l; low[1] ^= h;
+        clmul_64(a1, b1, h, l);
+        high[0] ^= l; high[1] ^= h;
+        clmul_64(a0 ^ a1, b0 ^ b1, h, l);
+        middle[0] ^= l; middle[1] ^= h;
+    }
+    gf128_wide wide;
+    wide.z[0] = low[0];
+    wide.z[1] = low[1] ^ middle[0] ^ low[0] ^ high[0];
+    wide.z[2] = high[0] ^ middle[1] ^ low[1] ^ high[1];
+    wide.z[3] = high[1];
+    return gf128_reduce(wide);
+}
+
+#ifdef KUZNECHIK_X86_CLMUL
+// Старшее 64-битное слово регистра (без SSE4.1)
+static inline uint64_t high_word(__m128i x)
+{
+    return (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(x, x));
+}
+
+// PCLMULQDQ: блок загружается в регистр как есть (порядок ядра совпадает с порядком числа),
+// три умножения по Карацубе на каждый член суммы
+__attribute__((target("pclmul")))
+static block gf128_multiply_sum_clmul(const block a[], const block b[], size_t count)
+{
+    __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128(), middle = _mm_setzero_si128();
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)&a[i]);
+        __m128i y = _mm_loadu_si128((const __m128i*)&b[i]);
+        low = _mm_xor_si128(low, _mm_clmulepi64_si128(x, y, 0x00));
+        high = _mm_xor_si128(high, _mm_clmulepi64_si128(x, y, 0x11));
+        __m128i x_halves = _mm_xor_si128(x, _mm_shuffle_epi32(x, 0x4E)); // a0 ⊕ a1 в обеих половинах
+        __m128i y_halves = _mm_xor_si128(y, _mm_shuffle_epi32(y, 0x4E));
+        middle = _mm_xor_si128(middle, _mm_clmulepi64_si128(x_halves, y_halves, 0x00));
+    }
+    middle = _mm_xor_si128(middle, _mm_xor_si128(low, high));
+    gf128_wide wide;
+    wide.z[0] = (uint64_t)_mm_cvtsi128_si64(low);
+    wide.z[1] = high_word(low) ^ (uint64_t)_mm_cvtsi128_si64(middle);
+    wide.z[2] = (uint64_t)_mm_cvtsi128_si64(high) ^ high_word(middle);
+    wide.z[3] = high_word(high);
+    return gf128_reduce(wide);
+}
+#endif
+
+bool gf128_clmul_supported()
+{
+#ifdef KUZNECHIK_X86_CLMUL
+    static const bool supported = __builtin_cpu_supports("pclmul");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+block gf128_multiply_sum(const block a[], const block b[], size_t count)
+{
+#ifdef KUZNECHIK_X86_CLMUL
+    if (gf128_clmul_supported())
+        return gf128_multiply_sum_clmul(a, b, count);
+#endif
+    return gf128_multiply_sum_generic(a, b, count);
+}
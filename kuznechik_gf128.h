@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "kuznechik_block.h"
+
+// Умножение в поле GF(2^128) по модулю x^128 + x^7 + x^2 + x + 1 (режим MGM, Р 1323565.1.026-2019)
+// Блок трактуется как 128-битное число в порядке ядра: байт 15 — старший, high() — старшее слово
+
+// Поддерживает ли процессор PCLMULQDQ (умножение многочленов без переносов)
+bool gf128_clmul_supported();
+
+// Сумма произведений a[0]·b[0] ⊕ … ⊕ a[count-1]·b[count-1]
+// Произведения складываются неприведёнными (256 бит), приведение по модулю — одно на всю сумму
+// Переносимый вариант: умножение 64×64 через целочисленное умножение с «дырами» между битами,
+// без таблиц и ветвлений по данным
+block gf128_multiply_sum_generic(const block a[], const block b[], size_t count);
+// То же через PCLMULQDQ, если процессор его поддерживает
+block gf128_multiply_sum(const block a[], const block b[], size_t count);
+
+// Произведение двух элементов поля
+inline block gf128_multiply(const block& a, const block& b) { return gf128_multiply_sum(&a, &b, 1); }
@@ -0,0 +1,186 @@
+#include "kuznechik_hex.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define KUZNECHIK_X86_HEX
+#include <immintrin.h>
+#endif
+
+static const char hex_digits[] = "0123456789abcdef";
+
+// Значения hex-символов, 0xFF — не hex-символ
+struct hex_value_table
+{
+    unsigned char values[256];
+    constexpr hex_value_table() : values()
+    {
+        for (int c = 0; c < 256; c++)
+            values[c] = 0xFF;
+        for (int c = 0; c < 10; c++)
+            values['0' + c] = c;
+        for (int c = 0; c < 6; c++)
+            values['a' + c] = values['A' + c] = 10 + c;
+    }
+};
+static constexpr hex_value_table hex_values;
+
+void hex_encode_generic(const unsigned char* bytes, size_t length, char* hexadecimal)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hexadecimal[2 * i] = hex_digits[bytes[i] >> 4];
+        hexadecimal[2 * i + 1] = hex_digits[bytes[i] & 0xF];
+    }
+}
+
+bool hex_decode_generic(const char* hexadecimal, size_t length, unsigned char* bytes)
+{
+    if (length % 2 != 0)
+        return false;
+    // Ошибки копятся в одном байте: 0xFF в любом полубайте даёт старший бит
+    unsigned char invalid = 0;
+    for (size_t i = 0; i < length / 2; i++)
+    {
+        const unsigned char high = hex_values.values[(unsigned char)hexadecimal[2 * i]];
+        const unsigned char low = hex_values.values[(unsigned char)hexadecimal[2 * i + 1]];
+        invalid |= high | low;
+        bytes[i] = (high << 4) | (low & 0xF);
+    }
+    return (invalid & 0xF0) == 0;
+}
+
+#ifdef KUZNECHIK_X86_HEX
+// Полубайты переводятся в символы одним PSHUFB по таблице "0123456789abcdef", затем чередуются
+__attribute__((target("ssse3")))
+static inline void hex_encode_16(const unsigned char* bytes, char* hexadecimal)
+{
+    const __m128i digits = _mm_loadu_si128((const __m128i*)hex_digits);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i x = _mm_loadu_si128((const __m128i*)bytes);
+    const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(x, 4), nibble));
+    const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(x, nibble));
+    _mm_storeu_si128((__m128i*)hexadecimal, _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128((__m128i*)(hexadecimal + 16), _mm_unpackhi_epi8(high, low));
+}
+
+__attribute__((target("ssse3")))
+static void hex_encode_ssse3(const unsigned char* bytes, size_t length, char* hexadecimal)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+        hex_encode_16(bytes + i, hexadecimal + 2 * i);
+    hex_encode_generic(bytes + i, length - i, hexadecimal + 2 * i);
+}
+
+__attribute__((target("avx2")))
+static void hex_encode_avx2(const unsigned char* bytes, size_t length, char* hexadecimal)
+{
+    const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)hex_digits));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(bytes + i));
+        const __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+        const __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(x, nibble));
+        // Чередование идёт внутри 128-битных половин: байты 0–7 и 16–23, 8–15 и 24–31
+        const __m256i first = _mm256_unpacklo_epi8(high, low);
+        const __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i*)(hexadecimal + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i*)(hexadecimal + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    hex_encode_ssse3(bytes + i, length - i, hexadecimal + 2 * i);
+}
+
+// Значения 16 символов и маска допустимых: цифра — c - '0' не больше 9, буква — (c | 0x20) - 'a' не больше 5
+// (вычитание без знака переполняется для символов ниже диапазона, и они тоже не проходят)
+__attribute__((target("ssse3")))
+static inline __m128i hex_values_16(__m128i c, __m128i& valid)
+{
+    const __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    valid = _mm_and_si128(valid, _mm_or_si128(is_digit, is_letter));
+    return _mm_or_si128(_mm_and_si128(is_digit, digit), _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+// Пары полубайтов собираются в байты одним PMADDUBSW: старший × 16 + младший
+__attribute__((target("ssse3")))
+static bool hex_decode_ssse3(const char* hexadecimal, size_t length, unsigned char* bytes)
+{
+    if (length % 2 != 0)
+        return false;
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    __m128i valid = _mm_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        // Оба вектора символов читаются до записи байтов: при декодировании на месте запись не обгоняет чтение
+        const __m128i first = hex_values_16(_mm_loadu_si128((const __m128i*)(hexadecimal + i)), valid);
+        const __m128i second = hex_values_16(_mm_loadu_si128((const __m128i*)(hexadecimal + i + 16)), valid);
+        _mm_storeu_si128((__m128i*)(bytes + i / 2), _mm_packus_epi16(_mm_maddubs_epi16(first, weights), _mm_maddubs_epi16(second, weights)));
+    }
+    return _mm_movemask_epi8(valid) == 0xFFFF && hex_decode_generic(hexadecimal + i, length - i, bytes + i / 2);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i hex_values_32(__m256i c, __m256i& valid)
+{
+    const __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    const __m256i letter = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    const __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+    valid = _mm256_and_si256(valid, _mm256_or_si256(is_digit, is_letter));
+    return _mm256_or_si256(_mm256_and_si256(is_digit, digit), _mm256_and_si256(is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2")))
+static bool hex_decode_avx2(const char* hexadecimal, size_t length, unsigned char* bytes)
+{
+    if (length % 2 != 0)
+        return false;
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    __m256i valid = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64)
+    {
+        const __m256i first = hex_values_32(_mm256_loadu_si256((const __m256i*)(hexadecimal + i)), valid);
+        const __m256i second = hex_values_32(_mm256_loadu_si256((const __m256i*)(hexadecimal + i + 32)), valid);
+        // Упаковка идёт внутри 128-битных половин, четверти переставляются на свои места
+        const __m256i packed = _mm256_packus_epi16(_mm256_maddubs_epi16(first, weights), _mm256_maddubs_epi16(second, weights));
+        _mm256_storeu_si256((__m256i*)(bytes + i / 2), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return _mm256_movemask_epi8(valid) == -1 && hex_decode_ssse3(hexadecimal + i, length - i, bytes + i / 2);
+}
+
+// Лучший поддерживаемый вариант: 2 — AVX2, 1 — SSSE3, 0 — переносимый
+static int hex_codec_level()
+{
+    static const int level = __builtin_cpu_supports("avx2") ? 2 : __builtin_cpu_supports("ssse3") ? 1 : 0;
+    return level;
+}
+#endif
+
+void hex_encode(const unsigned char* bytes, size_t length, char* hexadecimal)
+{
+#ifdef KUZNECHIK_X86_HEX
+    switch (hex_codec_level())
+    {
+        case 2: return hex_encode_avx2(bytes, length, hexadecimal);
+        case 1: return hex_encode_ssse3(bytes, length, hexadecimal);
+    }
+#endif
+    hex_encode_generic(bytes, length, hexadecimal);
+}
+
+bool hex_decode(const char* hexadecimal, size_t length, unsigned char* bytes)
+{
+#ifdef KUZNECHIK_X86_HEX
+    switch (hex_codec_level())
+    {
+        case 2: return hex_decode_avx2(hexadecimal, length, bytes);
+        case 1: return hex_decode_ssse3(hexadecimal, length, bytes);
+    }
+#endif
+    return hex_decode_generic(hexadecimal, length, bytes);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Шестнадцатеричное представление данных: каждый байт — два символа, старший полубайт первым
+// Кодирование и декодирование пишут в буферы вызывающего, без выделения памяти; на x86 используются
+// SSSE3 (16 байтов за шаг) и AVX2 (32 байта), если процессор их поддерживает
+
+// Размер куска в символах, которым читаются и пишутся hex-файлы
+const size_t hex_chunk_size = 1 << 16;
+
+// Кодирование length байтов в 2 * length строчных hex-символов (без завершающего нуля)
+void hex_encode(const unsigned char* bytes, size_t length, char* hexadecimal);
+// Декодирование length символов (цифры, a–f и A–F) в length / 2 байтов
+// Возвращает false, если длина нечётная или встретился не hex-символ (содержимое bytes тогда не определено)
+// bytes может совпадать с hexadecimal: декодирование на месте
+bool hex_decode(const char* hexadecimal, size_t length, unsigned char* bytes);
+
+// Переносимые варианты (для сравнения в замерах)
+void hex_encode_generic(const unsigned char* bytes, size_t length, char* hexadecimal);
+bool hex_decode_generic(const char* hexadecimal, size_t length, unsigned char* bytes);
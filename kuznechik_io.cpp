@@ -0,0 +1,231 @@
+#include "kuznechik_io.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define KUZNECHIK_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+// Потоков ввода-вывода в запасном варианте: они почти всё время ждут диск, а не процессор
+static const unsigned io_worker_count = 8;
+
+#ifdef KUZNECHIK_IO_URING
+// Кольца общие с ядром: индексы читаются с acquire и публикуются с release
+static inline unsigned load_acquire(const unsigned* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(unsigned* value, unsigned new_value)
+{
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+#endif
+
+io_queue::io_queue(unsigned depth, bool use_io_uring) : depth(depth)
+{
+    assert(depth != 0 && "Queue depth must be positive");
+#ifdef KUZNECHIK_IO_URING
+    if (use_io_uring)
+    {
+        io_uring_params parameters = {};
+        // Ядро само округлит размер кольца до степени двойки; завершений вдвое больше, чем заявок
+        const int descriptor = (int)syscall(__NR_io_uring_setup, depth, &parameters);
+        if (descriptor >= 0)
+        {
+            submission_ring_size = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+            completion_ring_size = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+            // Начиная с Linux 5.4 оба кольца отображаются одним вызовом
+            const bool single_mapping = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mapping)
+                submission_ring_size = completion_ring_size = std::max(submission_ring_size, completion_ring_size);
+            submission_entries_size = parameters.sq_entries * sizeof(io_uring_sqe);
+
+            submission_ring = mmap(nullptr, submission_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQ_RING);
+            completion_ring = single_mapping ? submission_ring : mmap(nullptr, completion_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_CQ_RING);
+            submission_entries = mmap(nullptr, submission_entries_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, IORING_OFF_SQES);
+            if (submission_ring != MAP_FAILED && completion_ring != MAP_FAILED && submission_entries != MAP_FAILED)
+            {
+                unsigned char* sq = (unsigned char*)submission_ring;
+                unsigned char* cq = (unsigned char*)completion_ring;
+                submission_head = (unsigned*)(sq + parameters.sq_off.head);
+                submission_tail = (unsigned*)(sq + parameters.sq_off.tail);
+                submission_mask = *(unsigned*)(sq + parameters.sq_off.ring_mask);
+                submission_array = (unsigned*)(sq + parameters.sq_off.array);
+                completion_head = (unsigned*)(cq + parameters.cq_off.head);
+                completion_tail = (unsigned*)(cq + parameters.cq_off.tail);
+                completion_mask = *(unsigned*)(cq + parameters.cq_off.ring_mask);
+                completion_entries = cq + parameters.cq_off.cqes;
+                this->depth = std::min(depth, parameters.sq_entries);
+                ring_descriptor = descriptor;
+                return;
+            }
+            // Не удалось отобразить кольца: освобождаем то, что получилось, и переходим на потоки
+            if (submission_entries != MAP_FAILED)
+                munmap(submission_entries, submission_entries_size);
+            if (completion_ring != MAP_FAILED && !single_mapping)
+                munmap(completion_ring, completion_ring_size);
+            if (submission_ring != MAP_FAILED)
+                munmap(submission_ring, submission_ring_size);
+            close(descriptor);
+        }
+    }
+#else
+    (void)use_io_uring;
+#endif
+    for (unsigned i = 0; i < std::min(depth, io_worker_count); i++)
+        workers.emplace_back(&io_queue::worker_loop, this);
+}
+
+io_queue::~io_queue()
+{
+    // Незавершённые операции дожидаются, чтобы ядро или потоки не писали в освобождённые буферы
+    std::vector<io_completion> leftovers;
+    while (in_flight != 0)
+        wait(leftovers);
+#ifdef KUZNECHIK_IO_URING
+    if (ring_descriptor >= 0)
+    {
+        munmap(submission_entries, submission_entries_size);
+        if (completion_ring != submission_ring)
+            munmap(completion_ring, completion_ring_size);
+        munmap(submission_ring, submission_ring_size);
+        close(ring_descriptor);
+        return;
+    }
+#endif
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    request_ready.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void io_queue::read(int descriptor, void* buffer, size_t length, uint64_t offset, uint64_t tag)
+{
+    enqueue({false, descriptor, buffer, length, offset, tag});
+}
+
+void io_queue::write(int descriptor, const void* buffer, size_t length, uint64_t offset, uint64_t tag)
+{
+    enqueue({true, descriptor, (void*)buffer, length, offset, tag});
+}
+
+void io_queue::enqueue(const operation& op)
+{
+    assert(in_flight < depth && "Too many operations in flight");
+    in_flight++;
+#ifdef KUZNECHIK_IO_URING
+    if (ring_descriptor >= 0)
+    {
+        // Кольцо заявок не длиннее depth, а незавершённых операций меньше depth: место в нём есть
+        const unsigned tail = *submission_tail;
+        const unsigned index = tail & submission_mask;
+        io_uring_sqe* entry = (io_uring_sqe*)submission_entries + index;
+        memset(entry, 0, sizeof(*entry));
+        entry->opcode = op.is_write ? IORING_OP_WRITE : IORING_OP_READ;
+        entry->fd = op.descriptor;
+        entry->addr = (uint64_t)(uintptr_t)op.buffer;
+        entry->len = (uint32_t)op.length;
+        entry->off = op.offset;
+        entry->user_data = op.tag;
+        submission_array[index] = index;
+        store_release(submission_tail, tail + 1);
+        to_submit++;
+        return;
+    }
+#endif
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back(op);
+    }
+    request_ready.notify_one();
+}
+
+void io_queue::submit()
+{
+#ifdef KUZNECHIK_IO_URING
+    while (ring_descriptor >= 0 && to_submit != 0)
+    {
+        const int submitted = (int)syscall(__NR_io_uring_enter, ring_descriptor, to_submit, 0, 0, nullptr, 0);
+        if (submitted < 0)
+        {
+            assert((errno == EINTR || errno == EAGAIN || errno == EBUSY) && "io_uring_enter failed");
+            continue;
+        }
+        to_submit -= submitted;
+    }
+#endif
+}
+
+void io_queue::wait(std::vector<io_completion>& completions)
+{
+    if (in_flight == 0)
+        return;
+#ifdef KUZNECHIK_IO_URING
+    if (ring_descriptor >= 0)
+    {
+        while (true)
+        {
+            // Забираем всё, что уже готово
+            unsigned head = *completion_head;
+            const unsigned tail = load_acquire(completion_tail);
+            const size_t reaped = tail - head;
+            for (; head != tail; head++)
+            {
+                const io_uring_cqe* entry = (const io_uring_cqe*)completion_entries + (head & completion_mask);
+                completions.push_back({entry->user_data, entry->res});
+            }
+            store_release(completion_head, head);
+            in_flight -= reaped;
+            if (reaped != 0 && to_submit == 0)
+                return;
+            // Отправляем оставшиеся заявки и, если ничего не готово, ждём первое завершение
+            const int submitted = (int)syscall(__NR_io_uring_enter, ring_descriptor, to_submit, reaped != 0 ? 0 : 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (submitted < 0)
+            {
+                assert((errno == EINTR || errno == EAGAIN || errno == EBUSY) && "io_uring_enter failed");
+                continue;
+            }
+            to_submit -= submitted;
+            if (reaped != 0)
+                return;
+        }
+    }
+#endif
+    std::unique_lock<std::mutex> lock(mutex);
+    completion_ready.wait(lock, [this] { return !completed.empty(); });
+    in_flight -= completed.size();
+    completions.insert(completions.end(), completed.begin(), completed.end());
+    completed.clear();
+}
+
+void io_queue::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        request_ready.wait(lock, [this] { return stopping || !requests.empty(); });
+        if (requests.empty())
+            return;
+        const operation op = requests.front();
+        requests.pop_front();
+        lock.unlock();
+        ssize_t result = op.is_write ? pwrite(op.descriptor, op.buffer, op.length, op.offset) : pread(op.descriptor, op.buffer, op.length, op.offset);
+        if (result < 0)
+            result = -errno;
+        lock.lock();
+        completed.push_back({op.tag, (long long)result});
+        completion_ready.notify_one();
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Завершённая операция ввода-вывода
+struct io_completion
+{
+    uint64_t tag; // Метка, переданная при постановке операции
+    long long result; // Число прочитанных или записанных байтов, при ошибке — -errno
+};
+
+// Очередь асинхронного чтения и записи файлов: операции ставятся без ожидания, завершения забираются пачкой
+// На Linux используется io_uring (системные вызовы напрямую, без liburing), иначе или если ядро его не
+// поддерживает — несколько потоков ввода-вывода с pread/pwrite. Очередью пользуется один поток
+class io_queue
+{
+    public:
+        // depth — наибольшее число одновременно незавершённых операций;
+        // use_io_uring = false — всегда потоки ввода-вывода
+        explicit io_queue(unsigned depth, bool use_io_uring = true);
+        ~io_queue();
+        io_queue(const io_queue&) = delete;
+        io_queue& operator=(const io_queue&) = delete;
+
+        // Чтение и запись length байтов по смещению offset; tag возвращается в завершении
+        void read(int descriptor, void* buffer, size_t length, uint64_t offset, uint64_t tag);
+        void write(int descriptor, const void* buffer, size_t length, uint64_t offset, uint64_t tag);
+        // Отправка поставленных операций ядру (или потокам) без ожидания
+        void submit();
+        // Ожидание хотя бы одного завершения, если есть незавершённые операции; готовые дописываются в completions
+        void wait(std::vector<io_completion>& completions);
+
+        // Число незавершённых операций
+        size_t pending() const { return in_flight; }
+        // Используется ли io_uring
+        bool uses_io_uring() const { return ring_descriptor >= 0; }
+
+    private:
+        struct operation
+        {
+            bool is_write;
+            int descriptor;
+            void* buffer;
+            size_t length;
+            uint64_t offset;
+            uint64_t tag;
+        };
+        void enqueue(const operation& op);
+
+        size_t in_flight = 0; // Поставлено и не забрано
+        unsigned depth;
+
+        // io_uring: дескриптор и отображённые кольца
+        int ring_descriptor = -1;
+        unsigned to_submit = 0; // Поставлено в кольцо, но не отправлено
+        void* submission_ring = nullptr;
+        size_t submission_ring_size = 0;
+        void* completion_ring = nullptr;
+        size_t completion_ring_size = 0;
+        void* submission_entries = nullptr;
+        size_t submission_entries_size = 0;
+        unsigned* submission_head = nullptr;
+        unsigned* submission_tail = nullptr;
+        unsigned submission_mask = 0;
+        unsigned* submission_array = nullptr;
+        unsigned* completion_head = nullptr;
+        unsigned* completion_tail = nullptr;
+        unsigned completion_mask = 0;
+        void* completion_entries = nullptr;
+
+        // Запасной вариант: потоки ввода-вывода с общими очередями заданий и завершений
+        void worker_loop();
+        std::vector<std::thread> workers;
+        std::deque<operation> requests;
+        std::vector<io_completion> completed;
+        std::mutex mutex;
+        std::condition_variable request_ready;
+        std::condition_variable completion_ready;
+        bool stopping = false;
+};
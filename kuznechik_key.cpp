@@ -0,0 +1,155 @@
+#include "kuznechik.h"
+
+// Развёртывание ключа выполняет kuznechik: ему принадлежат таблицы L∘S и итерационные константы
+key_context::key_context(const block& key_1, const block& key_2)
+{
+    kuznechik::expand_keys(&key_1, &key_2, 1, keys);
+}
+
+key_context::key_context(const char* hexadecimal_key)
+{
+    block key_1, key_2;
+    split_hexadecimal_key(hexadecimal_key, key_1, key_2);
+    kuznechik::expand_keys(&key_1, &key_2, 1, keys);
+}
+
+const block& key_context::operator[](int index) const
+{
+    assert(index >= 0 && index < number_of_iteration_keys && "Wrong index value"); // Проверка (до 10)
+    return keys[index];
+}
+
+// Сдвиг блока на бит влево как 128-битного числа (порядок ядра: байт 15 — старший, high() — старшее слово);
+// если выдвинут единичный бит, добавляется B_128 = 0^120 || 10000111
+static block shift_mac_subkey(const block& value)
+{
+    return block((value.low() << 1) ^ ((value.high() >> 63) * 0x87), (value.high() << 1) | (value.low() >> 63));
+}
+
+// R = E(0), K1 = R << 1 (с B_128 при выдвинутой единице), K2 = K1 << 1
+const block& key_context::mac_subkey(int index) const
+{
+    assert((index == 0 || index == 1) && "Wrong index value");
+    std::call_once(mac_subkeys_flag, [this]
+    {
+        block r;
+        encrypt_blocks_generic(kuznechik::ls_table.values, keys, &r, 1);
+        mac_subkeys[0] = shift_mac_subkey(r);
+        mac_subkeys[1] = shift_mac_subkey(mac_subkeys[0]);
+    });
+    return mac_subkeys[index];
+}
+
+// Расшифрование — x = x ^ K_10, затем 9 раз x = S⁻¹(L⁻¹(x)) ^ K_i. Вместо x хранится u = L⁻¹(x):
+// L⁻¹ аффинно, поэтому L⁻¹(S⁻¹(u) ^ K) = L⁻¹(S⁻¹(u)) ^ L⁻¹(K) ^ L⁻¹(0), и раунд становится таблицей
+// L⁻¹∘S⁻¹ и XOR с ключом L⁻¹(K) ^ L⁻¹(0). Ядро шифрования складывает ключ перед таблицей, поэтому
+// первый ключ нулевой (на вход подаётся S(x), и первая таблица даёт L⁻¹(x)), а K_1 остаётся последним
+const block* key_context::decryption_keys() const
+{
+    std::call_once(decryption_keys_flag, [this]
+    {
+        const block linear_constant = kuznechik::L_reversed(block());
+        reversed_keys[0] = block();
+        for (int i = 1; i < number_of_iteration_keys; i++)
+            reversed_keys[i] = kuznechik::L_reversed(keys[number_of_iteration_keys - i]) ^ linear_constant;
+        reversed_keys[number_of_iteration_keys] = keys[0];
+    });
+    return reversed_keys;
+}
+
+void split_hexadecimal_key(const char* hexadecimal_key, block& key_1, block& key_2)
+{
+    // Проверяем, что длина hex-ключа равна 64 символам (32 байта = 256 бит)
+    // Если длина неверная, программа завершится с ошибкой "Wrong key"
+    assert(strlen(hexadecimal_key) == 64 && "Wrong key");
+
+    // Преобразуем hex-ключ (64 символа) в строку байтов (32 байта)
+    // и делим её на два ключа: байты 0–15 и 16–31
+    unsigned char key_pair_bytes[2 * block::size];
+    bool valid = hex_decode(hexadecimal_key, 64, key_pair_bytes);
+    assert(valid && "Wrong key");
+    key_1 = block(key_pair_bytes);
+    key_2 = block(key_pair_bytes + block::size);
+}
+
+key_cache::key_cache(size_t capacity) : capacity(capacity)
+{
+    assert(capacity > 0 && "Wrong cache capacity");
+}
+
+size_t key_cache::master_key_hash::operator()(const master_key& key) const
+{
+    // Перемешивание слов ключа (умножение на нечётные константы)
+    uint64_t hash = key.key_1.low() * 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ key.key_1.high()) * 0xc2b2ae3d27d4eb4fULL;
+    hash = (hash ^ key.key_2.low()) * 0x165667b19e3779f9ULL;
+    hash = (hash ^ key.key_2.high()) * 0x9e3779b97f4a7c15ULL;
+    return hash ^ (hash >> 32);
+}
+
+std::shared_ptr<const key_context> key_cache::get(const block& key_1, const block& key_2)
+{
+    const master_key key = {key_1, key_2};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            entries.splice(entries.begin(), entries, found->second); // Запись становится самой свежей
+            return found->second->second;
+        }
+    }
+
+    // Ключ развёртывается без блокировки, чтобы не задерживать потоки с другими ключами
+    std::shared_ptr<const key_context> context = std::make_shared<const key_context>(key_1, key_2);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found != index.end()) // Другой поток успел развернуть тот же ключ
+    {
+        entries.splice(entries.begin(), entries, found->second);
+        return found->second->second;
+    }
+    entries.emplace_front(key, context);
+    index[key] = entries.begin();
+    evict();
+    return context;
+}
+
+std::shared_ptr<const key_context> key_cache::get(const char* hexadecimal_key)
+{
+    block key_1, key_2;
+    split_hexadecimal_key(hexadecimal_key, key_1, key_2);
+    return get(key_1, key_2);
+}
+
+void key_cache::set_capacity(size_t new_capacity)
+{
+    assert(new_capacity > 0 && "Wrong cache capacity");
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = new_capacity;
+    evict();
+}
+
+size_t key_cache::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+// Вытеснение давно не использованных ключей сверх ёмкости (вызывается под блокировкой)
+// Объекты, которые ещё держат вытесненный ключ, продолжают им пользоваться
+void key_cache::evict()
+{
+    while (entries.size() > capacity)
+    {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+key_cache& key_cache::global()
+{
+    static key_cache cache;
+    return cache;
+}
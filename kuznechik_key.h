@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "kuznechik_block.h"
+
+// Развёрнутый ключ: итерационные ключи для 10 раундов
+// Неизменяем после построения, поэтому один объект разделяется между любым числом шифрований и потоков
+class key_context
+{
+    public:
+        static const int number_of_iteration_keys = 10; // Количество итерационных ключей (10 раундов)
+
+        // Развёртывание ключа из двух 16-байтовых половин (сеть Фейстеля на 32 итерационных константах)
+        key_context(const block& key_1, const block& key_2);
+        // Развёртывание ключа из 64 hex-символов
+        explicit key_context(const char* hexadecimal_key);
+
+        // Итерационные ключи подряд, в порядке раундов
+        const block* iteration_keys() const { return keys; }
+        // Итерационный ключ по номеру раунда
+        const block& operator[](int index) const;
+        // Вспомогательный ключ имитовставки K1 (index 0) или K2 (index 1), ГОСТ Р 34.13-2015
+        // Вычисляется при первом обращении и хранится вместе с ключом, в том числе в key_cache
+        const block& mac_subkey(int index) const;
+        // Ключи расшифрования через таблицы L⁻¹∘S⁻¹ (kuznechik::decrypt_blocks): 10 ключей раундов
+        // ядра шифрования и ключ K_1, который снимается после последней S⁻¹; вычисляются при первом обращении
+        const block* decryption_keys() const;
+
+        static const int number_of_decryption_keys = number_of_iteration_keys + 1;
+
+    private:
+        block keys[number_of_iteration_keys];
+        mutable std::once_flag mac_subkeys_flag;
+        mutable block mac_subkeys[2];
+        mutable std::once_flag decryption_keys_flag;
+        mutable block reversed_keys[number_of_decryption_keys];
+};
+
+// Разбор ключа из 64 hex-символов на две 16-байтовые половины
+void split_hexadecimal_key(const char* hexadecimal_key, block& key_1, block& key_2);
+
+// Ограниченный кэш развёрнутых ключей с вытеснением давно не использованных (LRU)
+// Повторное шифрование под тем же ключом не развёртывает его заново; безопасен для нескольких потоков
+class key_cache
+{
+    public:
+        static const size_t default_capacity = 16; // Число ключей в кэше по умолчанию
+
+        explicit key_cache(size_t capacity = default_capacity);
+
+        // Развёрнутый ключ из кэша; при промахе ключ развёртывается и вытесняет самый старый
+        std::shared_ptr<const key_context> get(const block& key_1, const block& key_2);
+        std::shared_ptr<const key_context> get(const char* hexadecimal_key);
+
+        // Изменение ёмкости (лишние старые ключи вытесняются сразу)
+        void set_capacity(size_t new_capacity);
+        // Число ключей в кэше
+        size_t size();
+
+        // Общий кэш процесса, через него развёртывают ключи конструкторы kuznechik
+        static key_cache& global();
+
+    private:
+        // Исходный ключ — ключ кэша
+        struct master_key
+        {
+            block key_1;
+            block key_2;
+            bool operator==(const master_key& other) const { return key_1 == other.key_1 && key_2 == other.key_2; }
+        };
+        struct master_key_hash
+        {
+            size_t operator()(const master_key& key) const;
+        };
+        typedef std::list<std::pair<master_key, std::shared_ptr<const key_context>>> entry_list;
+
+        void evict();
+
+        size_t capacity;
+        entry_list entries; // Записи от недавно использованных к давно не использованным
+        std::unordered_map<master_key, entry_list::iterator, master_key_hash> index; // Поиск записи по ключу
+        std::mutex mutex;
+};
@@ -0,0 +1,243 @@
+#include "kuznechik_mac.h"
+
+cmac::cmac(std::shared_ptr<const key_context> key, engine_type engine) : cipher(std::move(key))
+{
+    cipher.set_engine(engine);
+    init();
+}
+
+cmac::cmac(const block& key_1, const block& key_2, engine_type engine) : cmac(key_cache::global().get(key_1, key_2), engine)
+{
+}
+
+void cmac::init()
+{
+    state = block();
+    buffered = 0;
+}
+
+// Табличный и векторный движки проходят цепочку одним вызовом, состояние не покидает регистров
+void cmac::chain(const unsigned char* data, size_t count)
+{
+    switch (cipher.engine)
+    {
+        case engine_type::table:
+            state = cbc_mac_blocks_generic(kuznechik::ls_table.values, cipher.key->iteration_keys(), state, data, count);
+            break;
+        case engine_type::simd:
+            state = cbc_mac_blocks_simd(kuznechik::ls_table.values, cipher.key->iteration_keys(), state, data, count);
+            break;
+        default:
+            for (size_t n = 0; n < count; n++)
+            {
+                state ^= block(data + n * block::size);
+                cipher.encrypt_blocks(&state, 1);
+            }
+    }
+}
+
+void cmac::update(const unsigned char* data, size_t length)
+{
+    // Пока данных не больше блока, неизвестно, будет ли он последним: только копим
+    if (buffered + length <= block::size)
+    {
+        if (length != 0)
+            memcpy(buffer + buffered, data, length);
+        buffered += length;
+        return;
+    }
+    // За буфером есть ещё данные: он дополняется до полного блока и уходит в цепочку
+    if (buffered != 0)
+    {
+        const size_t taken = block::size - buffered;
+        memcpy(buffer + buffered, data, taken);
+        chain(buffer, 1);
+        data += taken;
+        length -= taken;
+    }
+    // Последние 1–16 байтов остаются в буфере до следующего update или final
+    const size_t count = (length - 1) / block::size;
+    chain(data, count);
+    buffered = length - count * block::size;
+    memcpy(buffer, data + count * block::size, buffered);
+}
+
+void cmac::final(unsigned char mac[block::size])
+{
+    unsigned char last[block::size] = {};
+    block subkey = cipher.key->mac_subkey(0);
+    if (buffered == block::size)
+        memcpy(last, buffer, block::size);
+    else
+    {
+        // Неполный блок P* || 1 || 0…0: байты P* — старшие байты блока, единичный бит — старший бит байта под ними
+        memcpy(last + block::size - buffered, buffer, buffered);
+        last[block::size - 1 - buffered] = 0x80;
+        subkey = cipher.key->mac_subkey(1);
+    }
+    (block(last) ^ subkey).store(last);
+    chain(last, 1);
+    state.store(mac);
+    init();
+}
+
+void cmac::update_batch(cmac* const contexts[], const unsigned char* const data[], const size_t lengths[], size_t count)
+{
+    thread_pool::global().parallel_for(count, kuznechik::group_size, [&](size_t begin, size_t end)
+    {
+        // Группы не больше group_size сообщений (при выполнении без пула тело получает весь диапазон сразу)
+        for (size_t first = begin; first < end; first += kuznechik::group_size)
+        {
+            const size_t last = std::min(end, first + kuznechik::group_size);
+            // Цепочка одного сообщения группы: сначала, возможно, дополненный буфер, затем blocks блоков data,
+            // остаток tail уходит в буфер
+            struct lane
+            {
+                cmac* context;
+                bool from_buffer;
+                const unsigned char* data;
+                size_t blocks;
+                const unsigned char* tail;
+                size_t tail_length;
+            };
+            lane lanes[kuznechik::group_size];
+            size_t number_of_lanes = 0;
+            bool all_simd = true; // Векторное ядро, если все цепочки группы выбрали векторный движок
+
+            for (size_t m = first; m < last; m++)
+            {
+                cmac* context = contexts[m];
+                const unsigned char* position = data[m];
+                size_t length = lengths[m];
+                const engine_type engine = context->cipher.engine;
+                if ((engine != engine_type::table && engine != engine_type::simd) || context->buffered + length <= block::size)
+                {
+                    context->update(position, length);
+                    continue;
+                }
+                lane& current = lanes[number_of_lanes++];
+                current.context = context;
+                current.from_buffer = context->buffered != 0;
+                if (current.from_buffer)
+                {
+                    const size_t taken = block::size - context->buffered;
+                    memcpy(context->buffer + context->buffered, position, taken);
+                    position += taken;
+                    length -= taken;
+                }
+                current.data = position;
+                current.blocks = (length - 1) / block::size;
+                current.tail = position + current.blocks * block::size;
+                current.tail_length = length - current.blocks * block::size;
+                all_simd = all_simd && engine == engine_type::simd;
+            }
+            const size_t group_lanes = number_of_lanes;
+
+            // Шаг: по блоку каждой незавершённой цепочки, все блоки шифруются одним вызовом многоключевого ядра
+            // Когда цепочка остаётся одна, она дописывается путём с наименьшей задержкой
+            lane* active[kuznechik::group_size];
+            for (size_t l = 0; l < number_of_lanes; l++)
+                active[l] = &lanes[l];
+            while (number_of_lanes > 1)
+            {
+                block states[kuznechik::group_size];
+                const block* keys[kuznechik::group_size];
+                for (size_t l = 0; l < number_of_lanes; l++)
+                {
+                    lane& current = *active[l];
+                    const unsigned char* source = current.data;
+                    if (current.from_buffer)
+                    {
+                        source = current.context->buffer;
+                        current.from_buffer = false;
+                    }
+                    else
+                    {
+                        current.data += block::size;
+                        current.blocks--;
+                    }
+                    states[l] = current.context->state ^ block(source);
+                    keys[l] = current.context->cipher.key->iteration_keys();
+                }
+                if (all_simd)
+                    encrypt_blocks_simd_multikey(kuznechik::ls_table.values, keys, states, number_of_lanes);
+                else
+                    encrypt_blocks_generic_multikey(kuznechik::ls_table.values, keys, states, number_of_lanes);
+
+                size_t remaining = 0;
+                for (size_t l = 0; l < number_of_lanes; l++)
+                {
+                    active[l]->context->state = states[l];
+                    if (active[l]->from_buffer || active[l]->blocks != 0)
+                        active[remaining++] = active[l];
+                }
+                number_of_lanes = remaining;
+            }
+            if (number_of_lanes == 1)
+            {
+                lane& current = *active[0];
+                if (current.from_buffer)
+                    current.context->chain(current.context->buffer, 1);
+                current.context->chain(current.data, current.blocks);
+            }
+
+            // Буферы больше не нужны цепочкам: в них переносятся остатки сообщений
+            for (size_t l = 0; l < group_lanes; l++)
+            {
+                memcpy(lanes[l].context->buffer, lanes[l].tail, lanes[l].tail_length);
+                lanes[l].context->buffered = lanes[l].tail_length;
+            }
+        }
+    });
+}
+
+void mac_files(const char* const file_names[], size_t count, const char* key_1, const char* key_2, unsigned char macs[], engine_type engine)
+{
+    const std::shared_ptr<const key_context> key = key_cache::global().get(block(key_1), block(key_2));
+    for (size_t first = 0; first < count; first += mac_file_group_size)
+    {
+        const size_t group_count = std::min(mac_file_group_size, count - first);
+        std::vector<std::ifstream> streams;
+        std::vector<cmac> contexts;
+        streams.reserve(group_count);
+        contexts.reserve(group_count);
+        for (size_t m = 0; m < group_count; m++)
+        {
+            streams.emplace_back(file_names[first + m], std::ios::binary);
+            assert(streams.back() && "Can't find file");
+            contexts.emplace_back(key, engine);
+        }
+
+        // Каждый шаг читает очередной кусок всех ещё не дочитанных файлов группы и продвигает их цепочки вместе
+        std::vector<std::vector<unsigned char>> chunks(group_count, std::vector<unsigned char>(mac_file_chunk_size));
+        std::vector<size_t> chunk_lengths(group_count);
+        std::vector<cmac*> batch_contexts(group_count);
+        std::vector<const unsigned char*> batch_data(group_count);
+        std::vector<size_t> batch_lengths(group_count);
+        while (true)
+        {
+            thread_pool::global().parallel_for(group_count, 1, [&](size_t begin, size_t end)
+            {
+                for (size_t m = begin; m < end; m++)
+                {
+                    streams[m].read((char*)chunks[m].data(), mac_file_chunk_size);
+                    chunk_lengths[m] = streams[m].gcount();
+                }
+            });
+            size_t batch_count = 0;
+            for (size_t m = 0; m < group_count; m++)
+                if (chunk_lengths[m] != 0)
+                {
+                    batch_contexts[batch_count] = &contexts[m];
+                    batch_data[batch_count] = chunks[m].data();
+                    batch_lengths[batch_count] = chunk_lengths[m];
+                    batch_count++;
+                }
+            if (batch_count == 0)
+                break;
+            cmac::update_batch(batch_contexts.data(), batch_data.data(), batch_lengths.data(), batch_count);
+        }
+        for (size_t m = 0; m < group_count; m++)
+            contexts[m].final(macs + (first + m) * block::size);
+    }
+}
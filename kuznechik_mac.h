@@ -0,0 +1,44 @@
+#pragma once
+#include "kuznechik.h"
+
+// Имитовставка ГОСТ Р 34.13-2015 (CMAC, OMAC1) с потоковым интерфейсом: init, update любыми кусками, final
+// Все блоки, кроме последнего, проходят цепочку C_i = E(C_i-1 ^ P_i); последний складывается с K1
+// (полный) или, дополненный 1 0…0, с K2. Ключи K1 и K2 вычисляются один раз на ключ (key_context::mac_subkey)
+class cmac
+{
+    public:
+        explicit cmac(std::shared_ptr<const key_context> key, engine_type engine = engine_type::simd);
+        // Ключ развёртывается через общий кэш key_cache::global()
+        cmac(const block& key_1, const block& key_2, engine_type engine = engine_type::simd);
+
+        // Начало нового сообщения (вызывается конструктором и final)
+        void init();
+        // Очередной кусок сообщения произвольной длины
+        void update(const unsigned char* data, size_t length);
+        // Завершение сообщения: 16 байтов имитовставки в mac (усечённая имитовставка MSB_s — её старшие, последние байты)
+        void final(unsigned char mac[block::size]);
+
+        // Очередные куски count независимых сообщений за один вызов: data[m] длиной lengths[m] для contexts[m]
+        // Цепочки разных сообщений идут одновременно — их блоки шифруются вместе, заполняя векторные регистры,
+        // группы сообщений распределяются между потоками. Табличный и векторный движки; контексты с
+        // эталонным и битсрезовым обрабатываются по одному
+        static void update_batch(cmac* const contexts[], const unsigned char* const data[], const size_t lengths[], size_t count);
+
+    private:
+        kuznechik cipher; // Ключ и способ шифрования
+        block state; // C_i — результат цепочки по уже обработанным блокам
+        unsigned char buffer[block::size]; // Последний, ещё не обработанный блок: он может оказаться последним в сообщении
+        size_t buffered = 0; // Байтов в buffer
+
+        // Цепочка по count полным блокам data подряд, способом с наименьшей задержкой одного блока
+        void chain(const unsigned char* data, size_t count);
+};
+
+// Размер куска, которым читаются файлы при вычислении имитовставки
+const size_t mac_file_chunk_size = 1 << 18;
+// Сколько файлов обрабатывается вместе: их цепочки продвигаются одним вызовом cmac::update_batch
+const size_t mac_file_group_size = 256;
+
+// Имитовставки count файлов: файлы группами читаются кусками, цепочки группы продвигаются вместе
+// - macs: count * 16 байтов, имитовставка файла file_names[m] — с байта 16 * m
+void mac_files(const char* const file_names[], size_t count, const char* key_1, const char* key_2, unsigned char macs[], engine_type engine = engine_type::simd);
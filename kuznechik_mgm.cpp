@@ -0,0 +1,132 @@
+#include "kuznechik.h"
+
+// Счётчики MGM: блок — 128-битное число в порядке ядра (байт 15 — старший), как счётчик CTR
+// incr_r увеличивает правую (младшую) половину low(), incr_l — левую (старшую) high()
+static block mgm_increment_right(const block& counter, uint64_t step)
+{
+    return block(counter.low() + step, counter.high());
+}
+
+static block mgm_increment_left(const block& counter, uint64_t step)
+{
+    return block(counter.low(), counter.high() + step);
+}
+
+// Y_1 = E(0 || ICN), Z_1 = E(1 || ICN): старший бит байта 15 синхропосылки заменяется на 0 и 1
+void kuznechik::mgm_counters(const block& nonce, block& y_1, block& z_1) const
+{
+    block counters[2] = {nonce, nonce};
+    counters[0].set(block::size - 1, nonce[block::size - 1] & 0x7F);
+    counters[1].set(block::size - 1, nonce[block::size - 1] | 0x80);
+    encrypt_blocks(counters, 2);
+    y_1 = counters[0];
+    z_1 = counters[1];
+}
+
+block kuznechik::mgm_process(const block& y_1, const block& z_1, uint64_t first_block, uint64_t first_hash, const unsigned char* input, unsigned char* output, size_t length, bool decrypt) const
+{
+    const size_t count = (length + block::size - 1) / block::size;
+    block sum;
+    std::mutex sum_mutex;
+    parallel_for_blocks(count, [&](size_t begin, size_t end)
+    {
+        block part; // Сумма слагаемых куска: сложение в поле — XOR, порядок кусков не важен
+        for (size_t i = begin; i < end; i += group_size)
+        {
+            const size_t group_count = std::min((size_t)group_size, end - i);
+            // Первые group_count значений — Z_i (дают H_i), следующие — Y_i (дают гамму)
+            block counters[2 * group_size];
+            for (size_t j = 0; j < group_count; j++)
+                counters[j] = mgm_increment_left(z_1, first_hash + i + j);
+            if (output != nullptr)
+                for (size_t j = 0; j < group_count; j++)
+                    counters[group_count + j] = mgm_increment_right(y_1, first_block + i + j);
+            encrypt_blocks(counters, output != nullptr ? 2 * group_count : group_count);
+
+            block authenticated[group_size]; // C_i, неполный блок дополнен нулями
+            for (size_t j = 0; j < group_count; j++)
+            {
+                const size_t offset = (i + j) * block::size;
+                if (offset + block::size <= length)
+                {
+                    block data(input + offset);
+                    if (output == nullptr)
+                    {
+                        authenticated[j] = data;
+                        continue;
+                    }
+                    block result = data ^ counters[group_count + j];
+                    result.store(output + offset);
+                    authenticated[j] = decrypt ? data : result;
+                    continue;
+                }
+                // Последний неполный блок из r байтов: он занимает старшие байты блока (MSB_r стандарта), гамма —
+                // старшие r байтов блока гаммы, в имитовставку идёт блок с нулевыми младшими байтами
+                const size_t tail = length - offset;
+                unsigned char data[block::size] = {};
+                unsigned char result[block::size] = {};
+                memcpy(data + block::size - tail, input + offset, tail);
+                if (output != nullptr)
+                {
+                    unsigned char gamma[block::size];
+                    counters[group_count + j].store(gamma);
+                    for (size_t k = block::size - tail; k < block::size; k++)
+                        result[k] = data[k] ^ gamma[k];
+                    memcpy(output + offset, result + block::size - tail, tail);
+                }
+                authenticated[j] = block(output == nullptr || decrypt ? data : result);
+            }
+            part ^= gf128_multiply_sum(counters, authenticated, group_count);
+        }
+        std::lock_guard<std::mutex> lock(sum_mutex);
+        sum ^= part;
+    });
+    return sum;
+}
+
+// Последнее слагаемое — длины в битах: открытых данных в старшей половине, шифртекста — в младшей
+void kuznechik::mgm_finish(const block& z_1, block sum, size_t associated_length, size_t length, unsigned char tag[block::size]) const
+{
+    const uint64_t associated_blocks = (associated_length + block::size - 1) / block::size;
+    const uint64_t blocks = (length + block::size - 1) / block::size;
+    block hash = mgm_increment_left(z_1, associated_blocks + blocks);
+    encrypt_blocks(&hash, 1);
+    const block lengths((uint64_t)length * 8, (uint64_t)associated_length * 8);
+    sum ^= gf128_multiply(hash, lengths);
+    encrypt_blocks(&sum, 1);
+    sum.store(tag);
+}
+
+// Открытые данные занимают H_1…H_h, шифртекст — H_h+1…H_h+q
+void kuznechik::mgm_encrypt(const block& nonce, const unsigned char* associated_data, size_t associated_length, const unsigned char* input, unsigned char* output, size_t length, unsigned char tag[block::size]) const
+{
+    block y_1, z_1;
+    mgm_counters(nonce, y_1, z_1);
+    const uint64_t associated_blocks = (associated_length + block::size - 1) / block::size;
+    block sum = mgm_process(y_1, z_1, 0, 0, associated_data, nullptr, associated_length, false);
+    sum ^= mgm_process(y_1, z_1, 0, associated_blocks, input, output, length, false);
+    mgm_finish(z_1, sum, associated_length, length, tag);
+}
+
+bool kuznechik::mgm_decrypt(const block& nonce, const unsigned char* associated_data, size_t associated_length, const unsigned char* input, unsigned char* output, size_t length, const unsigned char tag[block::size]) const
+{
+    block y_1, z_1;
+    mgm_counters(nonce, y_1, z_1);
+    const uint64_t associated_blocks = (associated_length + block::size - 1) / block::size;
+    block sum = mgm_process(y_1, z_1, 0, 0, associated_data, nullptr, associated_length, false);
+    sum ^= mgm_process(y_1, z_1, 0, associated_blocks, input, output, length, true);
+    unsigned char expected_tag[block::size];
+    mgm_finish(z_1, sum, associated_length, length, expected_tag);
+
+    // Сравнение без раннего выхода, чтобы время не зависело от места расхождения
+    unsigned char difference = 0;
+    for (int i = 0; i < block::size; i++)
+        difference |= expected_tag[i] ^ tag[i];
+    if (difference != 0)
+    {
+        if (length != 0)
+            memset(output, 0, length);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,133 @@
+#include "kuznechik.h"
+
+// Блоки можно читать прямо из отображённых страниц, если порядок байтов в словах блока совпадает с памятью
+#if defined(__unix__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define KUZNECHIK_MAPPED_IO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef KUZNECHIK_MAPPED_IO
+// Подсказки ядру для отображения: чтение подряд и, где поддерживается, большие страницы
+static void advise_mapping(void* address, size_t length)
+{
+    madvise(address, length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(address, length, MADV_HUGEPAGE);
+#endif
+}
+#endif
+
+// Обработка файла через отображение в память: блоки шифруются прямо в страницах выходного файла
+// Для отдельного выходного файла каждое окно сначала копируется из входного и шифруется, пока лежит в кэше
+// Чтение в статистике — копирование окон из входного отображения (с подкачкой страниц), запись выполняет
+// ядро при сбросе страниц и не учитывается
+cipher_stats kuznechik::process_mapped(const char* input_file_name, const char* output_file_name, bool decrypt) const
+{
+    const bool in_place = output_file_name == nullptr || strcmp(input_file_name, output_file_name) == 0;
+    // В MGM длина файла меняется на имитовставку, а при расшифровании она проверяется после всех данных:
+    // такие файлы обрабатываются потоково
+    if (mode == cipher_mode::mgm)
+    {
+        assert(!in_place && "MGM files can't be processed in place");
+        return process_stream(input_file_name, output_file_name, false, decrypt);
+    }
+#ifdef KUZNECHIK_MAPPED_IO
+    cipher_stats stats;
+    stats_scope scope(stats);
+    stats.files = 1;
+    int input_descriptor = open(input_file_name, in_place ? O_RDWR : O_RDONLY);
+    assert(input_descriptor >= 0 && "Can't find file");
+    struct stat input_status;
+    fstat(input_descriptor, &input_status);
+    const size_t length = input_status.st_size;
+
+    // Режимы без сохранения длины дополняют последний блок пробелами, выходной файл длиннее на дополнение
+    const size_t padded_length = (length + block::size - 1) / block::size * block::size;
+    const size_t output_length = is_length_preserving(mode) ? length : padded_length;
+
+    int output_descriptor = input_descriptor;
+    if (!in_place)
+    {
+        output_descriptor = open(output_file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        assert(output_descriptor >= 0 && "Can't open file");
+    }
+    int resized = ftruncate(output_descriptor, output_length);
+    assert(resized == 0 && "Can't resize file");
+
+    double start = omp_get_wtime();
+    if (output_length != 0)
+    {
+        unsigned char* output_bytes = (unsigned char*)mmap(nullptr, output_length, PROT_READ | PROT_WRITE, MAP_SHARED, output_descriptor, 0);
+        assert(output_bytes != MAP_FAILED && "Can't map file");
+        advise_mapping(output_bytes, output_length);
+        const unsigned char* input_bytes = output_bytes;
+        if (!in_place)
+        {
+            input_bytes = (const unsigned char*)mmap(nullptr, length, PROT_READ, MAP_PRIVATE, input_descriptor, 0);
+            assert(input_bytes != MAP_FAILED && "Can't map file");
+            advise_mapping((void*)input_bytes, length);
+        }
+
+        // Целые блоки шифруются на месте в отображении (страницы выровнены, порядок байтов совпадает)
+        block* blocks = (block*)output_bytes;
+        const size_t number_of_blocks = output_length / block::size;
+        const size_t window_blocks = mapped_window_size / block::size;
+        block chaining_block = initialization_vector;
+        acpkm_chain acpkm;
+        double copy_time = 0;
+        std::vector<uint64_t> items = thread_pool::global().processed_items();
+        for (size_t i = 0; i < number_of_blocks; i += window_blocks)
+        {
+            size_t count = std::min(window_blocks, number_of_blocks - i);
+            double copy_start = omp_get_wtime();
+            if (!in_place)
+                memcpy(blocks + i, input_bytes + i * block::size, std::min(count * block::size, length - i * block::size));
+            copy_time += omp_get_wtime() - copy_start;
+            if (i + count == number_of_blocks && padded_length != length && !is_length_preserving(mode))
+                memset(output_bytes + length, ' ', padded_length - length); // Дополнение последнего блока
+            if (decrypt)
+                decrypt_chunk(blocks + i, count, i, chaining_block, acpkm);
+            else
+                encrypt_chunk(blocks + i, count, i, chaining_block, acpkm);
+        }
+
+        // Неполный последний блок в режимах гаммирования обрабатывается через копию и обрезается
+        const size_t tail_length = output_length - number_of_blocks * block::size;
+        if (tail_length != 0)
+        {
+            unsigned char tail_bytes[block::size];
+            memset(tail_bytes, ' ', block::size);
+            memcpy(tail_bytes, input_bytes + number_of_blocks * block::size, tail_length);
+            block tail(tail_bytes);
+            if (decrypt)
+                decrypt_chunk(&tail, 1, number_of_blocks, chaining_block, acpkm);
+            else
+                encrypt_chunk(&tail, 1, number_of_blocks, chaining_block, acpkm);
+            tail.store(tail_bytes);
+            memcpy(output_bytes + number_of_blocks * block::size, tail_bytes, tail_length);
+        }
+        stats.add_thread_blocks(items);
+        stats.read_time += copy_time;
+        stats.cipher_time -= copy_time;
+
+        if (!in_place)
+            munmap((void*)input_bytes, length);
+        munmap(output_bytes, output_length);
+    }
+    stats.cipher_time += omp_get_wtime() - start;
+    stats.bytes = length;
+
+    if (!in_place)
+        close(output_descriptor);
+    close(input_descriptor);
+    scope.finish();
+    return stats;
+#else
+    // Без отображения в память файл обрабатывается потоково (на месте так нельзя: вывод перезаписал бы ввод)
+    assert(!in_place && "In-place encryption requires memory-mapped files");
+    return process_stream(input_file_name, output_file_name, false, decrypt);
+#endif
+}
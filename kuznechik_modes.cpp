@@ -0,0 +1,325 @@
+#include "kuznechik.h"
+
+// Гамма CTR: счётчик — 128-битное число, старшая половина (байты 8–15) — синхропосылка,
+// младшая — номер блока в потоке (ГОСТ Р 34.13-2015: CTR_1 = IV || 0, CTR_i+1 = CTR_i + 1)
+void kuznechik::generate_ctr_gamma(block gamma[], size_t count, uint64_t initialization_vector, uint64_t first_block) const
+{
+    for (size_t i = 0; i < count; i++)
+        gamma[i] = block(first_block + i, initialization_vector);
+    encrypt_blocks(gamma, count); // Значения счётчика независимы и шифруются одной пачкой
+}
+
+// Наложение гаммы CTR на блоки на месте
+void kuznechik::apply_ctr_gamma(block blocks[], size_t count, uint64_t initialization_vector, uint64_t first_block) const
+{
+    parallel_for_blocks(count, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i += group_size)
+        {
+            block gamma[group_size];
+            size_t group_count = std::min((size_t)group_size, end - i);
+            generate_ctr_gamma(gamma, group_count, initialization_vector, first_block + i);
+            for (size_t j = 0; j < group_count; j++)
+                blocks[i + j] ^= gamma[j];
+        }
+    });
+}
+
+void kuznechik::set_acpkm_section_size(size_t new_section_size)
+{
+    assert(new_section_size != 0 && new_section_size % block::size == 0 && "ACPKM section must be a whole number of blocks");
+    acpkm_section_size = new_section_size;
+}
+
+// Шифр секции section в кольце chain: её ключ — E(D_1) || E(D_2) под ключом секции section - 1
+void kuznechik::next_acpkm_cipher(acpkm_chain& chain, uint64_t section) const
+{
+    const kuznechik& previous = *chain.ciphers[(section - 1) % acpkm_chain::capacity];
+    // D = 80 81 … 9F старшим байтом вперёд; в порядке ядра (байт 15 — старший) первая половина — 8F … 80
+    // от байта 0 к байту 15
+    block halves[2] = {block(0x88898A8B8C8D8E8F, 0x8081828384858687), block(0x98999A9B9C9D9E9F, 0x9091929394959697)};
+    encrypt_blocks_generic(ls_table.values, previous.key->iteration_keys(), halves, 2);
+    // Ключ секции хранится в самой цепочке, шифр ссылается на него без владения: память не выделяется,
+    // и ключи секций не попадают в key_cache (каждый нужен одному потоку и вытеснил бы ключи пользователей)
+    const size_t slot = section % acpkm_chain::capacity;
+    chain.keys[slot].emplace(halves[0], halves[1]);
+    chain.ciphers[slot].emplace(std::shared_ptr<const key_context>(std::shared_ptr<const key_context>(), &*chain.keys[slot]));
+    chain.ciphers[slot]->engine = engine; // Движок уже подготовлен этим объектом
+}
+
+// Гамма CTR-ACPKM: значение счётчика то же, что в CTR, но шифруется ключом своей секции
+// Шифры секций лежат в кольце chain из acpkm_chain::capacity ячеек, поэтому участок, задевающий больше
+// секций, обрабатывается частями
+void kuznechik::apply_acpkm_gamma(block blocks[], size_t count, uint64_t initialization_vector, uint64_t first_block, acpkm_chain& chain) const
+{
+    const uint64_t section_blocks = acpkm_section_size / block::size;
+    // Секция 0 шифруется исходным ключом: короткие данные — обычный CTR, цепочка не нужна
+    if ((first_block + count - 1) / section_blocks == 0)
+    {
+        apply_ctr_gamma(blocks, count, initialization_vector, first_block);
+        return;
+    }
+    while (count != 0)
+    {
+        const uint64_t first_section = first_block / section_blocks;
+        const size_t part_count = std::min<uint64_t>(count, (first_section + acpkm_chain::capacity) * section_blocks - first_block);
+        const uint64_t last_section = (first_block + part_count - 1) / section_blocks;
+        // Назад по цепочке не пройти: участок раньше запомненных секций начинает её с исходного ключа
+        if (chain.size == 0 || first_section < chain.first_section)
+        {
+            chain.ciphers[0].emplace(key);
+            chain.ciphers[0]->engine = engine;
+            chain.first_section = 0;
+            chain.size = 1;
+        }
+        // Секции раньше участка не нужны, кроме последней из них — с неё цепочка продолжается
+        const uint64_t passed = std::min<uint64_t>(first_section - chain.first_section, chain.size - 1);
+        chain.first_section += passed;
+        chain.size -= passed;
+        for (; chain.first_section < first_section; chain.first_section++)
+            next_acpkm_cipher(chain, chain.first_section + 1);
+        while (chain.first_section + chain.size <= last_section)
+        {
+            next_acpkm_cipher(chain, chain.first_section + chain.size);
+            chain.size++;
+        }
+        const kuznechik* section_ciphers[acpkm_chain::capacity];
+        for (uint64_t section = first_section; section <= last_section; section++)
+            section_ciphers[section - first_section] = &*chain.ciphers[section % acpkm_chain::capacity];
+
+        parallel_for_blocks(part_count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end;)
+            {
+                // Группа не пересекает границу секции
+                const uint64_t block_number = first_block + i;
+                const uint64_t section = block_number / section_blocks;
+                size_t group_count = std::min<uint64_t>(std::min((size_t)group_size, end - i), (section + 1) * section_blocks - block_number);
+                block gamma[group_size];
+                section_ciphers[section - first_section]->generate_ctr_gamma(gamma, group_count, initialization_vector, block_number);
+                for (size_t j = 0; j < group_count; j++)
+                    blocks[i + j] ^= gamma[j];
+                i += group_count;
+            }
+        });
+        blocks += part_count;
+        count -= part_count;
+        first_block += part_count;
+    }
+}
+
+// Режим CTR над произвольным участком потока
+void kuznechik::ctr_crypt(const unsigned char* input, unsigned char* output, size_t length, uint64_t initialization_vector, uint64_t offset) const
+{
+    const uint64_t first_block = offset / block::size; // Блок гаммы, в который попадает первый байт
+    const size_t skipped_bytes = offset % block::size; // Байты этого блока до начала input
+    const size_t number_of_blocks = (skipped_bytes + length + block::size - 1) / block::size;
+
+    parallel_for_blocks(number_of_blocks, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i += group_size)
+        {
+            block gamma[group_size];
+            size_t group_count = std::min((size_t)group_size, end - i);
+            generate_ctr_gamma(gamma, group_count, initialization_vector, first_block + i);
+            unsigned char gamma_bytes[group_size * block::size];
+            for (size_t j = 0; j < group_count; j++)
+                gamma[j].store(gamma_bytes + j * block::size);
+
+            // Байты группы в input: [position, position + group_count * 16), обрезанные по границам input
+            long long position = (long long)(i * block::size) - (long long)skipped_bytes;
+            long long from = std::max(0LL, -position);
+            long long to = std::min((long long)(group_count * block::size), (long long)length - position);
+            for (long long j = from; j < to; j++)
+                output[position + j] = input[position + j] ^ gamma_bytes[j];
+        }
+    });
+}
+
+// Блоки, предшествующие каждому куску пула в окне: для куска, начинающегося с блока i, это blocks[i - 1],
+// для первого — first (синхропосылка или последний блок шифртекста предыдущего окна)
+void kuznechik::collect_chunk_predecessors(const block blocks[], size_t count, const block& first, block predecessors[])
+{
+    predecessors[0] = first;
+    for (size_t i = parallel_grain; i < count; i += parallel_grain)
+        predecessors[i / parallel_grain] = blocks[i - 1];
+}
+
+// CBC: C_i = E(P_i ^ C_i-1), C_0 = IV
+void kuznechik::cbc_encrypt(block blocks[], size_t count, const block& initialization_vector) const
+{
+    block previous = initialization_vector;
+    for (size_t i = 0; i < count; i++)
+    {
+        previous ^= blocks[i];
+        encrypt_blocks(&previous, 1);
+        blocks[i] = previous;
+    }
+}
+
+// CBC: P_i = D(C_i) ^ C_i-1, блоки расшифровываются независимо
+// Окнами по chaining_window_blocks: кусок пула начинает с блока перед собой из predecessors, дальше предыдущий
+// блок шифртекста переносится от группы к группе
+void kuznechik::cbc_decrypt(block blocks[], size_t count, const block& initialization_vector) const
+{
+    block window_predecessor = initialization_vector;
+    for (size_t first = 0; first < count; first += chaining_window_blocks)
+    {
+        block* window = blocks + first;
+        const size_t window_count = std::min(chaining_window_blocks, count - first);
+        block predecessors[chaining_window_blocks / parallel_grain];
+        collect_chunk_predecessors(window, window_count, window_predecessor, predecessors);
+        window_predecessor = window[window_count - 1];
+
+        parallel_for_blocks(window_count, [&](size_t begin, size_t end)
+        {
+            block previous = predecessors[begin / parallel_grain];
+            for (size_t i = begin; i < end; i += group_size)
+            {
+                size_t group_count = std::min((size_t)group_size, end - i);
+                block decrypted[group_size];
+                std::copy(window + i, window + i + group_count, decrypted);
+                decrypt_blocks(decrypted, group_count);
+                for (size_t j = 0; j < group_count; j++)
+                {
+                    block ciphertext = window[i + j];
+                    window[i + j] = decrypted[j] ^ previous;
+                    previous = ciphertext;
+                }
+            }
+        });
+    }
+}
+
+// CFB: C_i = P_i ^ E(C_i-1), C_0 = IV
+void kuznechik::cfb_encrypt(block blocks[], size_t count, const block& initialization_vector) const
+{
+    block gamma = initialization_vector;
+    for (size_t i = 0; i < count; i++)
+    {
+        encrypt_blocks(&gamma, 1);
+        blocks[i] ^= gamma;
+        gamma = blocks[i];
+    }
+}
+
+// CFB: P_i = C_i ^ E(C_i-1), гамма группы — пачка зашифрований известных блоков шифртекста
+// Окнами, как cbc_decrypt
+void kuznechik::cfb_decrypt(block blocks[], size_t count, const block& initialization_vector) const
+{
+    block window_predecessor = initialization_vector;
+    for (size_t first = 0; first < count; first += chaining_window_blocks)
+    {
+        block* window = blocks + first;
+        const size_t window_count = std::min(chaining_window_blocks, count - first);
+        block predecessors[chaining_window_blocks / parallel_grain];
+        collect_chunk_predecessors(window, window_count, window_predecessor, predecessors);
+        window_predecessor = window[window_count - 1];
+
+        parallel_for_blocks(window_count, [&](size_t begin, size_t end)
+        {
+            block previous = predecessors[begin / parallel_grain];
+            for (size_t i = begin; i < end; i += group_size)
+            {
+                size_t group_count = std::min((size_t)group_size, end - i);
+                block gamma[group_size];
+                gamma[0] = previous;
+                for (size_t j = 1; j < group_count; j++)
+                    gamma[j] = window[i + j - 1];
+                previous = window[i + group_count - 1];
+                encrypt_blocks(gamma, group_count);
+                for (size_t j = 0; j < group_count; j++)
+                    window[i + j] ^= gamma[j];
+            }
+        });
+    }
+}
+
+// OFB: Y_i = E(Y_i-1), Y_0 = IV, C_i = P_i ^ Y_i
+void kuznechik::ofb_crypt(block blocks[], size_t count, const block& initialization_vector) const
+{
+    block gamma = initialization_vector;
+    for (size_t i = 0; i < count; i++)
+    {
+        encrypt_blocks(&gamma, 1);
+        blocks[i] ^= gamma;
+    }
+}
+
+// Зашифрование одного куска потока в выбранном режиме
+void kuznechik::encrypt_chunk(block blocks[], size_t count, uint64_t first_block, block& chaining_block, acpkm_chain& acpkm) const
+{
+    assert(mode != cipher_mode::mgm && "MGM is processed by mgm_encrypt and mgm_decrypt");
+    if (count == 0)
+        return;
+
+    // В режиме CTR блоки не шифруются, а складываются с гаммой (распараллеливание внутри),
+    // режимы с зацеплением шифруют блоки по очереди и передают последний блок следующему куску
+    if (mode == cipher_mode::ctr)
+        apply_ctr_gamma(blocks, count, initialization_vector.low(), first_block);
+    else if (mode == cipher_mode::ctr_acpkm)
+        apply_acpkm_gamma(blocks, count, initialization_vector.low(), first_block, acpkm);
+    else if (mode == cipher_mode::cbc || mode == cipher_mode::cfb)
+    {
+        if (mode == cipher_mode::cbc)
+            cbc_encrypt(blocks, count, chaining_block);
+        else
+            cfb_encrypt(blocks, count, chaining_block);
+        chaining_block = blocks[count - 1];
+    }
+    else if (mode == cipher_mode::ofb)
+    {
+        // Регистр OFB — последний блок гаммы: открытый текст ^ шифртекст последнего блока
+        block last_block = blocks[count - 1];
+        ofb_crypt(blocks, count, chaining_block);
+        chaining_block = blocks[count - 1] ^ last_block;
+    }
+    else if (engine != engine_type::reference)
+    {
+        // Быстрые движки получают блоки группами: независимые блоки чередуются в одном потоке,
+        // заполняют векторные регистры или битсрезовую пачку
+        parallel_for_blocks(count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i += group_size)
+                encrypt_blocks(&blocks[i], std::min((size_t)group_size, end - i));
+        });
+    }
+    else
+    {
+        // Эталонный движок шифрует каждый блок SP-сетью (9 раундов S-L + финальный XOR)
+        parallel_for_blocks(count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+                blocks[i] = encrypt_block(blocks[i]);
+        });
+    }
+}
+
+// Расшифрование одного куска потока в выбранном режиме
+void kuznechik::decrypt_chunk(block blocks[], size_t count, uint64_t first_block, block& chaining_block, acpkm_chain& acpkm) const
+{
+    assert(mode != cipher_mode::mgm && "MGM is processed by mgm_encrypt and mgm_decrypt");
+    if (count == 0)
+        return;
+
+    if (mode == cipher_mode::ctr || mode == cipher_mode::ctr_acpkm || mode == cipher_mode::ofb) // Расшифрование в CTR и OFB совпадает с зашифрованием
+        encrypt_chunk(blocks, count, first_block, chaining_block, acpkm);
+    else if (mode == cipher_mode::cbc || mode == cipher_mode::cfb) // CBC и CFB расшифровываются параллельно
+    {
+        block last_block = blocks[count - 1];
+        if (mode == cipher_mode::cbc)
+            cbc_decrypt(blocks, count, chaining_block);
+        else
+            cfb_decrypt(blocks, count, chaining_block);
+        chaining_block = last_block;
+    }
+    else
+    {
+        // Блоки расшифровываются группами, как и зашифровываются (decrypt_blocks выбирает движок)
+        parallel_for_blocks(count, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i += group_size)
+                decrypt_blocks(&blocks[i], std::min((size_t)group_size, end - i));
+        });
+    }
+}
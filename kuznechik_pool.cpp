@@ -0,0 +1,194 @@
+#include "kuznechik_pool.h"
+#include <cassert>
+#include <omp.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Поток уже выполняет тело parallel_for: вложенные вызовы идут последовательно
+static thread_local bool inside_pool = false;
+// Номер потока в пуле (0 — вызывающие потоки)
+static thread_local int pool_thread_index = 0;
+
+std::unique_ptr<thread_pool> thread_pool::global_pool;
+std::mutex thread_pool::global_mutex;
+
+#ifdef __linux__
+static bool pin_thread(pthread_t thread, int cpu)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    return pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set) == 0;
+}
+#endif
+
+thread_pool::thread_pool(int threads, const std::vector<int>& cpus)
+{
+    number_of_threads = threads > 0 ? threads : omp_get_max_threads();
+    ranges.reset(new worker_range[number_of_threads]);
+    for (int i = 0; i < number_of_threads; i++)
+    {
+        ranges[i].next = 0;
+        ranges[i].end = 0;
+        ranges[i].processed = 0;
+    }
+    worker_cpus = cpus;
+}
+
+// Фоновые потоки создаются при первой работе, которую стоит делить: маленьким входам (и программе,
+// которая обрабатывает один небольшой файл) создание потоков не нужно
+void thread_pool::start_workers()
+{
+    for (int i = 1; i < number_of_threads; i++)
+    {
+        workers.emplace_back(&thread_pool::worker_loop, this, i);
+#ifdef __linux__
+        if (!worker_cpus.empty())
+            pin_thread(workers.back().native_handle(), worker_cpus[i % worker_cpus.size()]);
+#endif
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void thread_pool::worker_loop(int index)
+{
+    inside_pool = true;
+    pool_thread_index = index;
+    uint64_t seen_generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(state_mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen_generation; });
+            if (stopping)
+                return;
+            seen_generation = generation;
+        }
+        run_share(index);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (--active_workers == 0)
+                done.notify_one();
+        }
+    }
+}
+
+void thread_pool::run_share(int index)
+{
+    // Куски берутся атомарным увеличением счётчика части: свой поток и крадущие не получат один кусок дважды
+    uint64_t processed = 0;
+    auto process = [this, &processed](worker_range& range)
+    {
+        for (;;)
+        {
+            size_t chunk = range.next.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= range.end)
+                return;
+            size_t begin = chunk * job_grain;
+            size_t end = std::min(begin + job_grain, job_count);
+            (*job_body)(begin, end);
+            processed += end - begin;
+        }
+    };
+    process(ranges[index]);
+    for (int k = 1; k < number_of_threads; k++)
+        process(ranges[(index + k) % number_of_threads]);
+    ranges[index].processed.fetch_add(processed, std::memory_order_relaxed);
+}
+
+void thread_pool::parallel_for(size_t count, size_t grain, range_body body, size_t serial_limit)
+{
+    assert(grain > 0 && "Wrong grain");
+    if (count == 0)
+        return;
+    const size_t chunks = (count + grain - 1) / grain;
+    // Один кусок (маленькие данные) или данные не больше serial_limit не стоят пробуждения потоков
+    if (number_of_threads == 1 || chunks == 1 || count <= serial_limit || inside_pool)
+    {
+        body(0, count);
+        if (!inside_pool)
+            ranges[0].processed.fetch_add(count, std::memory_order_relaxed);
+        return;
+    }
+
+    std::lock_guard<std::mutex> job_lock(job_mutex);
+    if (workers.empty())
+        start_workers();
+    // Непрерывные равные части: поток i всегда получает одну и ту же часть одинакового диапазона
+    for (int i = 0; i < number_of_threads; i++)
+    {
+        ranges[i].next.store(chunks * i / number_of_threads, std::memory_order_relaxed);
+        ranges[i].end = chunks * (i + 1) / number_of_threads;
+    }
+    job_body = &body;
+    job_count = count;
+    job_grain = grain;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        active_workers = number_of_threads - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    inside_pool = true;
+    run_share(0);
+    inside_pool = false;
+
+    std::unique_lock<std::mutex> lock(state_mutex);
+    done.wait(lock, [this] { return active_workers == 0; });
+}
+
+std::vector<uint64_t> thread_pool::processed_items() const
+{
+    std::vector<uint64_t> items(number_of_threads);
+    for (int i = 0; i < number_of_threads; i++)
+        items[i] = ranges[i].processed.load(std::memory_order_relaxed);
+    return items;
+}
+
+int thread_pool::current_thread_index()
+{
+    return pool_thread_index;
+}
+
+bool thread_pool::in_parallel_region()
+{
+    return inside_pool;
+}
+
+thread_pool& thread_pool::global()
+{
+    std::lock_guard<std::mutex> lock(global_mutex);
+    if (!global_pool)
+        global_pool.reset(new thread_pool());
+    return *global_pool;
+}
+
+void thread_pool::configure(int threads, const std::vector<int>& cpus)
+{
+    std::lock_guard<std::mutex> lock(global_mutex);
+    global_pool.reset(new thread_pool(threads, cpus));
+}
+
+bool thread_pool::pin_current_thread(int cpu)
+{
+#ifdef __linux__
+    return pin_thread(pthread_self(), cpu);
+#else
+    (void)cpu;
+    return false;
+#endif
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Невладеющая ссылка на тело цикла body(begin, end) для thread_pool::parallel_for
+// В отличие от std::function не копирует вызываемый объект (лямбда с захватом по ссылке не помещается в
+// буфер std::function и выделялась бы в куче при каждом вызове): хранит только адрес объекта и функцию
+// его вызова. Объект должен жить до возврата из parallel_for — временная лямбда в аргументе живёт
+class range_body
+{
+    public:
+        template <typename F> requires (!std::is_same_v<std::remove_cvref_t<F>, range_body>)
+        range_body(const F& body) : object(&body), call([](const void* object, size_t begin, size_t end) { (*(const F*)object)(begin, end); }) {}
+
+        void operator()(size_t begin, size_t end) const { call(object, begin, end); }
+
+    private:
+        const void* object;
+        void (*call)(const void* object, size_t begin, size_t end);
+};
+
+// Постоянный пул потоков: потоки создаются один раз (при первой работе, которую стоит делить) и ждут работы,
+// а не запускаются на каждый вызов
+// Диапазон делится на куски по grain элементов. Каждый поток сначала берёт куски из своей непрерывной
+// части диапазона (при одинаковом разбиении одни и те же данные попадают к одному и тому же потоку),
+// а закончив её, забирает оставшиеся куски из частей других потоков (work stealing)
+class thread_pool
+{
+    public:
+        // threads — число потоков вместе с вызывающим (0 — как у OpenMP: OMP_NUM_THREADS или число процессоров)
+        // cpus — процессоры, к которым по кругу закрепляются фоновые потоки 1, 2, ... (пусто — без закрепления);
+        //        cpus[0] предназначен вызывающему потоку, его можно закрепить через pin_current_thread
+        explicit thread_pool(int threads = 0, const std::vector<int>& cpus = std::vector<int>());
+        ~thread_pool();
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        // Вызов body(begin, end) для кусков [0, count) по grain элементов; возвращается, когда обработаны все
+        // Вызывающий поток работает наравне с фоновыми. Вызовы из разных потоков выполняются по очереди,
+        // вложенный вызов из тела parallel_for выполняется последовательно в том же потоке
+        // - serial_limit: при count не больше него всё выполняется в вызывающем потоке (пробуждение
+        //   пула дороже работы, см. dispatch_profile)
+        void parallel_for(size_t count, size_t grain, range_body body, size_t serial_limit = 0);
+
+        // Число потоков вместе с вызывающим
+        int size() const { return number_of_threads; }
+
+        // Сколько элементов диапазонов parallel_for обработал каждый поток (индекс 0 — вызывающие потоки)
+        // с создания пула; вложенные вызовы не считаются — их элементы уже учтены внешним вызовом
+        std::vector<uint64_t> processed_items() const;
+        // Номер текущего потока в пуле: 1, 2, ... для фоновых, 0 для остальных
+        static int current_thread_index();
+        // Выполняется ли текущий поток внутри parallel_for (вложенные вызовы идут последовательно)
+        static bool in_parallel_region();
+
+        // Общий пул процесса, через него распараллеливаются режимы шифрования
+        static thread_pool& global();
+        // Пересоздание общего пула (нельзя вызывать, пока пул выполняет работу)
+        static void configure(int threads, const std::vector<int>& cpus = std::vector<int>());
+        // Закрепление текущего потока за процессором (false, если не удалось или не поддерживается)
+        static bool pin_current_thread(int cpu);
+
+    private:
+        // Часть диапазона одного потока в кусках, в своей кэш-линии, чтобы потоки не мешали друг другу
+        struct alignas(64) worker_range
+        {
+            std::atomic<size_t> next; // Следующий необработанный кусок (его же увеличивают крадущие потоки)
+            size_t end; // Конец части
+            std::atomic<uint64_t> processed; // Обработано элементов потоком с этим номером
+        };
+
+        void worker_loop(int index);
+        // Создание фоновых потоков (при первом parallel_for, который делится между ними)
+        void start_workers();
+        // Обработка своей части, затем кусков других потоков
+        void run_share(int index);
+
+        int number_of_threads;
+        std::vector<std::thread> workers;
+        std::vector<int> worker_cpus; // Процессоры для закрепления фоновых потоков
+        std::unique_ptr<worker_range[]> ranges;
+
+        std::mutex job_mutex; // Очередь вызовов parallel_for из разных потоков
+        std::mutex state_mutex;
+        std::condition_variable wake; // Новая работа или остановка
+        std::condition_variable done; // Все фоновые потоки закончили работу
+        uint64_t generation = 0; // Номер текущей работы
+        int active_workers = 0; // Фоновые потоки, ещё не закончившие текущую работу
+        bool stopping = false;
+
+        // Текущая работа
+        const range_body* job_body = nullptr;
+        size_t job_count = 0;
+        size_t job_grain = 0;
+
+        static std::unique_ptr<thread_pool> global_pool;
+        static std::mutex global_mutex;
+};
+
+// Буфер под данные, обрабатываемые через пул: память выделяется без заполнения и заполняется через пул
+// тем же разбиением, каким потом обрабатывается, поэтому на машинах NUMA страницы достаются узлам
+// обрабатывающих их потоков (первое касание)
+template <typename T>
+class first_touch_buffer
+{
+    public:
+        first_touch_buffer(size_t count, size_t grain, const T& value = T()) : count(count),
+            values(static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T) > 64 ? alignof(T) : 64))))
+        {
+            thread_pool::global().parallel_for(count, grain, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                    new (values + i) T(value);
+            });
+        }
+        ~first_touch_buffer() { ::operator delete(values, std::align_val_t(alignof(T) > 64 ? alignof(T) : 64)); }
+        first_touch_buffer(const first_touch_buffer&) = delete;
+        first_touch_buffer& operator=(const first_touch_buffer&) = delete;
+
+        T* data() { return values; }
+        size_t size() const { return count; }
+        T& operator[](size_t index) { return values[index]; }
+
+    private:
+        size_t count;
+        T* values;
+};
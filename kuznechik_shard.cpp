@@ -0,0 +1,336 @@
+#include "kuznechik_shard.h"
+#include <fcntl.h>
+#include <filesystem>
+#include <spawn.h>
+#include <sstream>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+static const char* const manifest_magic = "kuznechik-shards";
+static const int manifest_version = 1;
+
+// Синхропосылка в описании — 32 hex-символа, байты блока по порядку
+static std::string block_to_hex(const block& value)
+{
+    unsigned char bytes[block::size];
+    value.store(bytes);
+    char hexadecimal[2 * block::size];
+    hex_encode(bytes, block::size, hexadecimal);
+    return std::string(hexadecimal, sizeof(hexadecimal));
+}
+
+static bool hex_to_block(const std::string& hexadecimal, block& value)
+{
+    unsigned char bytes[block::size];
+    if (hexadecimal.length() != 2 * block::size || !hex_decode(hexadecimal.data(), hexadecimal.length(), bytes))
+        return false;
+    value = block(bytes);
+    return true;
+}
+
+// Контрольная сумма шифртекста: 64-битные слова перемешиваются умножением, продолжается с state
+// Не криптографическая: ловит недописанные и перепутанные участки, а не подделку
+static uint64_t shard_checksum(uint64_t state, const unsigned char* bytes, size_t length)
+{
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        state = (state ^ word) * 0x9e3779b97f4a7c15ULL;
+        state ^= state >> 29;
+    }
+    for (; i < length; i++)
+        state = (state ^ bytes[i]) * 0x100000001b3ULL;
+    return state;
+}
+static const uint64_t shard_checksum_seed = 0xcbf29ce484222325ULL;
+
+static bool read_exactly(int descriptor, unsigned char* bytes, size_t length, uint64_t offset)
+{
+    while (length != 0)
+    {
+        ssize_t result = pread(descriptor, bytes, length, offset);
+        if (result <= 0)
+            return false;
+        bytes += result;
+        length -= result;
+        offset += result;
+    }
+    return true;
+}
+
+static bool write_exactly(int descriptor, const unsigned char* bytes, size_t length, uint64_t offset)
+{
+    while (length != 0)
+    {
+        ssize_t result = pwrite(descriptor, bytes, length, offset);
+        if (result <= 0)
+            return false;
+        bytes += result;
+        length -= result;
+        offset += result;
+    }
+    return true;
+}
+
+static std::string done_file_name(const char* manifest_file_name, size_t index)
+{
+    return std::string(manifest_file_name) + "." + std::to_string(index) + ".done";
+}
+
+// Строка записи о завершении; при проверке сравнивается всё, кроме контрольной суммы, которая пересчитывается
+static std::string done_record(const shard_manifest& manifest, size_t index)
+{
+    const shard_range& shard = manifest.shards[index];
+    return "done " + std::to_string(index) + " " + std::to_string(shard.offset) + " " + std::to_string(shard.length) + " " + block_to_hex(manifest.initialization_vector);
+}
+
+static void write_manifest(const char* manifest_file_name, const shard_manifest& manifest)
+{
+    // Описание пишется во временный файл и переименовывается: исполнители не увидят его недописанным
+    const std::string temporary_name = std::string(manifest_file_name) + ".tmp";
+    std::ofstream output_stream(temporary_name);
+    assert(output_stream.is_open() && "Can't open file");
+    output_stream << manifest_magic << " " << manifest_version << "\n";
+    output_stream << "length " << manifest.length << "\n";
+    output_stream << "iv " << block_to_hex(manifest.initialization_vector) << "\n";
+    output_stream << "input " << manifest.input_file_name << "\n";
+    output_stream << "output " << manifest.output_file_name << "\n";
+    for (size_t i = 0; i < manifest.shards.size(); i++)
+        output_stream << "shard " << i << " " << manifest.shards[i].offset << " " << manifest.shards[i].length << "\n";
+    output_stream.close();
+    assert(output_stream && "Can't write file");
+    int renamed = rename(temporary_name.c_str(), manifest_file_name);
+    assert(renamed == 0 && "Can't write file");
+    (void)renamed;
+}
+
+shard_manifest read_shard_manifest(const char* manifest_file_name)
+{
+    std::ifstream input_stream(manifest_file_name);
+    assert(input_stream && "Can't find file");
+    shard_manifest manifest;
+    std::string magic;
+    int version = 0;
+    input_stream >> magic >> version;
+    assert(magic == manifest_magic && version == manifest_version && "Wrong shard manifest");
+    for (std::string field; input_stream >> field;)
+    {
+        if (field == "length")
+            input_stream >> manifest.length;
+        else if (field == "iv")
+        {
+            std::string hexadecimal;
+            input_stream >> hexadecimal;
+            bool valid = hex_to_block(hexadecimal, manifest.initialization_vector);
+            assert(valid && "Wrong shard manifest");
+            (void)valid;
+        }
+        else if (field == "input" || field == "output")
+        {
+            // Путь — весь остаток строки (может содержать пробелы)
+            std::string path;
+            std::getline(input_stream >> std::ws, path);
+            (field == "input" ? manifest.input_file_name : manifest.output_file_name) = path;
+        }
+        else if (field == "shard")
+        {
+            size_t index;
+            shard_range shard;
+            input_stream >> index >> shard.offset >> shard.length;
+            assert(index == manifest.shards.size() && "Wrong shard manifest");
+            manifest.shards.push_back(shard);
+        }
+        else
+            assert(false && "Wrong shard manifest");
+    }
+    return manifest;
+}
+
+shard_manifest plan_shards(const char* manifest_file_name, const char* input_file_name, const char* output_file_name, size_t count, const block& initialization_vector)
+{
+    assert(count > 0 && "Wrong number of shards");
+    std::ifstream input_stream(input_file_name, std::ios::binary | std::ios::ate);
+    assert(input_stream && "Can't find file");
+    shard_manifest manifest;
+    // Пути абсолютные: исполнители могут запускаться из другого каталога
+    manifest.input_file_name = std::filesystem::absolute(input_file_name).lexically_normal().string();
+    manifest.output_file_name = std::filesystem::absolute(output_file_name).lexically_normal().string();
+    manifest.length = input_stream.tellg();
+    manifest.initialization_vector = initialization_vector;
+
+    // Участки поровну, границы округляются до shard_alignment; у маленького файла участков меньше count
+    const uint64_t aligned_length = (manifest.length + shard_alignment - 1) / shard_alignment * shard_alignment;
+    const uint64_t shard_length = std::max<uint64_t>((aligned_length / count + shard_alignment - 1) / shard_alignment * shard_alignment, shard_alignment);
+    for (uint64_t offset = 0; offset < manifest.length; offset += shard_length)
+        manifest.shards.push_back({offset, std::min(shard_length, manifest.length - offset)});
+
+    // Перезапуск с тем же разбиением сохраняет записи о завершении
+    if (access(manifest_file_name, F_OK) == 0)
+    {
+        const shard_manifest existing = read_shard_manifest(manifest_file_name);
+        if (existing.input_file_name == manifest.input_file_name && existing.output_file_name == manifest.output_file_name && existing.length == manifest.length &&
+            existing.initialization_vector == manifest.initialization_vector && existing.shards.size() == manifest.shards.size())
+            return existing;
+    }
+    for (size_t i = 0; ; i++)
+        if (unlink(done_file_name(manifest_file_name, i).c_str()) != 0 && i >= manifest.shards.size())
+            break;
+
+    int output_descriptor = open(output_file_name, O_WRONLY | O_CREAT, 0644);
+    assert(output_descriptor >= 0 && "Can't open file");
+    int resized = ftruncate(output_descriptor, manifest.length);
+    assert(resized == 0 && "Can't resize file");
+    close(output_descriptor);
+    (void)resized;
+    write_manifest(manifest_file_name, manifest);
+    return manifest;
+}
+
+cipher_stats process_shard(const char* manifest_file_name, size_t index, const char* key_1, const char* key_2, engine_type engine)
+{
+    cipher_stats stats;
+    stats_scope scope(stats);
+    stats.files = 1;
+    const shard_manifest manifest = read_shard_manifest(manifest_file_name);
+    assert(index < manifest.shards.size() && "Wrong shard index");
+    const shard_range& shard = manifest.shards[index];
+    double start = omp_get_wtime();
+    kuznechik cipher{block(key_1), block(key_2)};
+    cipher.set_engine(engine);
+    stats.key_time = omp_get_wtime() - start;
+
+    int input_descriptor = open(manifest.input_file_name.c_str(), O_RDONLY);
+    assert(input_descriptor >= 0 && "Can't find file");
+    // Выходной файл не обрезается: в нём же пишут остальные исполнители
+    int output_descriptor = open(manifest.output_file_name.c_str(), O_WRONLY | O_CREAT, 0644);
+    assert(output_descriptor >= 0 && "Can't open file");
+
+    std::vector<unsigned char> chunk(std::min<uint64_t>(shard_chunk_size, shard.length));
+    uint64_t checksum = shard_checksum_seed;
+    std::vector<uint64_t> items = thread_pool::global().processed_items();
+    for (uint64_t position = shard.offset; position < shard.offset + shard.length; position += shard_chunk_size)
+    {
+        const size_t length = std::min<uint64_t>(shard_chunk_size, shard.offset + shard.length - position);
+        start = omp_get_wtime();
+        bool complete = read_exactly(input_descriptor, chunk.data(), length, position);
+        assert(complete && "Can't read file");
+        stats.read_time += omp_get_wtime() - start;
+        start = omp_get_wtime();
+        cipher.ctr_crypt(chunk.data(), chunk.data(), length, manifest.initialization_vector.low(), position);
+        stats.cipher_time += omp_get_wtime() - start;
+        checksum = shard_checksum(checksum, chunk.data(), length);
+        start = omp_get_wtime();
+        complete = write_exactly(output_descriptor, chunk.data(), length, position);
+        assert(complete && "Can't write file");
+        stats.write_time += omp_get_wtime() - start;
+        (void)complete;
+    }
+    // Запись о завершении появляется только после того, как шифртекст на диске
+    start = omp_get_wtime();
+    fsync(output_descriptor);
+    stats.write_time += omp_get_wtime() - start;
+    close(output_descriptor);
+    close(input_descriptor);
+    stats.add_thread_blocks(items);
+    stats.bytes = shard.length;
+
+    char hexadecimal_checksum[17];
+    std::snprintf(hexadecimal_checksum, sizeof(hexadecimal_checksum), "%016llx", (unsigned long long)checksum);
+    const std::string record_name = done_file_name(manifest_file_name, index);
+    {
+        std::ofstream record((record_name + ".tmp").c_str());
+        assert(record.is_open() && "Can't open file");
+        record << done_record(manifest, index) << " " << hexadecimal_checksum << "\n";
+    }
+    int renamed = rename((record_name + ".tmp").c_str(), record_name.c_str());
+    assert(renamed == 0 && "Can't write file");
+    (void)renamed;
+    scope.finish();
+    return stats;
+}
+
+std::vector<size_t> verify_shards(const char* manifest_file_name)
+{
+    const shard_manifest manifest = read_shard_manifest(manifest_file_name);
+    std::vector<size_t> failed;
+    int output_descriptor = open(manifest.output_file_name.c_str(), O_RDONLY);
+    std::vector<unsigned char> chunk;
+    for (size_t i = 0; i < manifest.shards.size(); i++)
+    {
+        // Запись о завершении должна относиться к этому же разбиению; оборванная или испорченная запись
+        // (сумма не из 16 hex-символов) означает перезапуск участка, а не ошибку проверки
+        std::ifstream record(done_file_name(manifest_file_name, i));
+        std::string line;
+        std::getline(record, line);
+        const std::string expected = done_record(manifest, i) + " ";
+        if (output_descriptor < 0 || line.length() != expected.length() + 16 || line.compare(0, expected.length(), expected) != 0 ||
+            line.find_first_not_of("0123456789abcdefABCDEF", expected.length()) != std::string::npos)
+        {
+            failed.push_back(i);
+            continue;
+        }
+        // Контрольная сумма пересчитывается по тому, что лежит в выходном файле
+        const shard_range& shard = manifest.shards[i];
+        chunk.resize(std::min<uint64_t>(shard_chunk_size, shard.length));
+        uint64_t checksum = shard_checksum_seed;
+        bool complete = true;
+        for (uint64_t position = shard.offset; complete && position < shard.offset + shard.length; position += shard_chunk_size)
+        {
+            const size_t length = std::min<uint64_t>(shard_chunk_size, shard.offset + shard.length - position);
+            complete = read_exactly(output_descriptor, chunk.data(), length, position);
+            checksum = shard_checksum(checksum, chunk.data(), length);
+        }
+        if (!complete || std::stoull(line.substr(expected.length()), nullptr, 16) != checksum)
+            failed.push_back(i);
+    }
+    if (output_descriptor >= 0)
+        close(output_descriptor);
+    return failed;
+}
+
+std::vector<size_t> run_shard_workers(const std::vector<std::string>& command, const char* manifest_file_name, const std::vector<size_t>& indices, size_t parallel)
+{
+    assert(!command.empty() && parallel > 0 && "Wrong worker command");
+    std::vector<size_t> failed;
+    std::vector<std::pair<pid_t, size_t>> running; // Процесс и его участок
+    auto wait_one = [&]
+    {
+        int status = 0;
+        const pid_t finished = wait(&status);
+        for (size_t r = 0; r < running.size(); r++)
+            if (running[r].first == finished)
+            {
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                    failed.push_back(running[r].second);
+                running.erase(running.begin() + r);
+                return;
+            }
+    };
+    for (size_t index : indices)
+    {
+        while (running.size() >= parallel)
+            wait_one();
+        std::vector<std::string> arguments = command;
+        arguments.push_back("--shard=" + std::to_string(index));
+        arguments.push_back(manifest_file_name);
+        std::vector<char*> argv;
+        for (std::string& argument : arguments)
+            argv.push_back(&argument[0]);
+        argv.push_back(nullptr);
+        pid_t process;
+        if (posix_spawn(&process, argv[0], nullptr, nullptr, argv.data(), environ) != 0)
+        {
+            failed.push_back(index);
+            continue;
+        }
+        running.push_back({process, index});
+    }
+    while (!running.empty())
+        wait_one();
+    std::sort(failed.begin(), failed.end());
+    return failed;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "kuznechik.h"
+
+// Обработка огромного файла несколькими процессами (на этой машине или на разных, с общим хранилищем)
+// Файл делится на участки (shards) по границам shard_alignment; каждый участок шифруется в режиме CTR
+// гаммой со своего смещения в файле, поэтому участки независимы, а результат совпадает с --mode=ctr
+// для всего файла. Процесс-исполнитель пишет шифртекст своего участка прямо на его место в выходном
+// файле и оставляет запись о завершении с контрольной суммой шифртекста; проверка находит участки без
+// записи или с несошедшейся суммой, и перезапускаются только они
+
+// Граница участков и размер куска, которым исполнитель читает и пишет участок
+const size_t shard_alignment = 1 << 20;
+const size_t shard_chunk_size = 1 << 22;
+
+// Участок исходного файла
+struct shard_range
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Описание разбиения (текстовый файл рядом с выходным):
+//   kuznechik-shards 1
+//   length <длина файла>
+//   iv <синхропосылка, 32 hex-символа>
+//   input <путь к входному файлу>
+//   output <путь к выходному файлу>
+//   shard <номер> <смещение> <длина>   — по строке на участок
+// Запись о завершении участка i — файл <описание>.<i>.done:
+//   done <номер> <смещение> <длина> <синхропосылка> <контрольная сумма шифртекста, 16 hex-символов>
+struct shard_manifest
+{
+    std::string input_file_name;
+    std::string output_file_name;
+    uint64_t length = 0;
+    block initialization_vector;
+    std::vector<shard_range> shards;
+};
+
+// Разбиение input_file_name на count участков; выходной файл создаётся нужной длины, описание
+// записывается в manifest_file_name. Если описание с теми же файлами, длиной, синхропосылкой и числом
+// участков уже есть, оно остаётся вместе с записями о завершении (перезапуск)
+shard_manifest plan_shards(const char* manifest_file_name, const char* input_file_name, const char* output_file_name, size_t count, const block& initialization_vector = block());
+shard_manifest read_shard_manifest(const char* manifest_file_name);
+
+// Исполнитель: шифрование (расшифрование — то же самое) участка index и запись о его завершении
+cipher_stats process_shard(const char* manifest_file_name, size_t index, const char* key_1, const char* key_2, engine_type engine = engine_type::table);
+
+// Проверка и сборка: номера участков, которые нужно (пере)запустить — без записи о завершении, с записью
+// от другого разбиения или с контрольной суммой, не совпавшей с шифртекстом в выходном файле. Ключ не нужен
+std::vector<size_t> verify_shards(const char* manifest_file_name);
+
+// Локальная замена распределённого запуска: исполнители — отдельные процессы command + --shard=<i> <описание>,
+// одновременно не больше parallel. Возвращает номера участков, чьи процессы завершились с ошибкой
+std::vector<size_t> run_shard_workers(const std::vector<std::string>& command, const char* manifest_file_name, const std::vector<size_t>& indices, size_t parallel);
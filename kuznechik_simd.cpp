@@ -0,0 +1,315 @@
+#include "kuznechik_simd.h"
+#include <atomic>
+#include <cassert>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define KUZNECHIK_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// Откуда ядра берут итерационные ключи: один ключ на все блоки или свой ключ у каждого блока
+// Ядра — шаблоны по этим правилам, поэтому одноключевой путь не платит за многоключевой
+struct shared_keys
+{
+    static const bool is_shared = true;
+    const block* keys;
+    const block& get(size_t, int round) const { return keys[round]; }
+};
+
+struct per_block_keys
+{
+    static const bool is_shared = false;
+    const block* const* keys; // keys[n] — итерационные ключи блока n
+    const block& get(size_t n, int round) const { return keys[n][round]; }
+};
+
+// Переносимый вариант: состояние в двух 64-битных словах, 16 обращений к таблицам на раунд
+template <typename key_source>
+static void encrypt_blocks_generic(const block table[][UCHAR_MAX + 1], key_source keys, block blocks[], size_t count)
+{
+    for (size_t n = 0; n < count; n++)
+    {
+        block state = blocks[n];
+        for (int i = 0; i < 9; i++) // 9 раундов
+        {
+            state ^= keys.get(n, i); // XOR с ключом
+            uint64_t lo = state.low();
+            uint64_t hi = state.high();
+            state = table[0][lo & 0xFF] ^ table[8][hi & 0xFF];
+            for (int j = 1; j < 8; j++) // L(S(x)) как XOR таблиц для каждого байта
+                state ^= table[j][(lo >> (8 * j)) & 0xFF] ^ table[j + 8][(hi >> (8 * j)) & 0xFF];
+        }
+        blocks[n] = state ^ keys.get(n, 9); // Финальный XOR
+    }
+}
+
+#ifdef KUZNECHIK_X86_SIMD
+// Раунд L∘S для одного блока в XMM: байты извлекаются через два 64-битных слова,
+// записи таблиц загружаются и складываются целыми 128-битными регистрами
+static inline __m128i ls_round_sse2(const block table[][UCHAR_MAX + 1], __m128i x)
+{
+    uint64_t lo = (uint64_t)_mm_cvtsi128_si64(x);
+    uint64_t hi = (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(x, x));
+    __m128i y = _mm_setzero_si128();
+    for (int j = 0; j < 8; j++)
+    {
+        y = _mm_xor_si128(y, _mm_load_si128((const __m128i*)&table[j][(lo >> (8 * j)) & 0xFF]));
+        y = _mm_xor_si128(y, _mm_load_si128((const __m128i*)&table[j + 8][(hi >> (8 * j)) & 0xFF]));
+    }
+    return y;
+}
+
+// Чередование (interleaving) нескольких независимых блоков: раунды разных блоков не зависят друг от
+// друга, поэтому загрузки из таблиц одного блока перекрываются с вычислениями остальных
+template <int ways, typename key_source>
+static inline void encrypt_interleaved_sse2(const block table[][UCHAR_MAX + 1], key_source keys, block blocks[], size_t first)
+{
+    __m128i x[ways];
+    for (int l = 0; l < ways; l++)
+        x[l] = _mm_loadu_si128((const __m128i*)&blocks[l]);
+    for (int i = 0; i < 9; i++)
+        for (int l = 0; l < ways; l++)
+            x[l] = ls_round_sse2(table, _mm_xor_si128(x[l], _mm_loadu_si128((const __m128i*)&keys.get(first + l, i))));
+    for (int l = 0; l < ways; l++)
+        _mm_storeu_si128((__m128i*)&blocks[l], _mm_xor_si128(x[l], _mm_loadu_si128((const __m128i*)&keys.get(first + l, 9))));
+}
+
+// SSE2 (базовый для x86-64): один блок в XMM, по 4 блока с чередованием
+template <typename key_source>
+static void encrypt_blocks_sse2(const block table[][UCHAR_MAX + 1], key_source keys, block blocks[], size_t count, size_t first = 0)
+{
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4)
+        encrypt_interleaved_sse2<4>(table, keys, blocks + n, first + n);
+    for (; n < count; n++)
+        encrypt_interleaved_sse2<1>(table, keys, blocks + n, first + n);
+}
+
+// Итерационный ключ раунда для двух соседних блоков в YMM
+template <typename key_source>
+__attribute__((target("avx2")))
+static inline __m256i round_key_avx2(key_source keys, size_t n, int round)
+{
+    if (key_source::is_shared)
+        return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&keys.get(n, round)));
+    return _mm256_loadu2_m128i((const __m128i*)&keys.get(n + 1, round), (const __m128i*)&keys.get(n, round));
+}
+
+// AVX2: два блока в YMM, записи таблиц для обоих блоков загружаются одной парой в 256-битный регистр
+template <typename key_source>
+__attribute__((target("avx2")))
+static void encrypt_blocks_avx2(const block table[][UCHAR_MAX + 1], key_source keys, block blocks[], size_t count, size_t first = 0)
+{
+    size_t n = 0;
+    for (; n + 2 <= count; n += 2)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&blocks[n]);
+        for (int i = 0; i < 9; i++)
+        {
+            x = _mm256_xor_si256(x, round_key_avx2(keys, first + n, i));
+            uint64_t lo_0 = (uint64_t)_mm256_extract_epi64(x, 0); // Первый блок
+            uint64_t hi_0 = (uint64_t)_mm256_extract_epi64(x, 1);
+            uint64_t lo_1 = (uint64_t)_mm256_extract_epi64(x, 2); // Второй блок
+            uint64_t hi_1 = (uint64_t)_mm256_extract_epi64(x, 3);
+            __m256i y = _mm256_setzero_si256();
+            for (int j = 0; j < 8; j++)
+            {
+                y = _mm256_xor_si256(y, _mm256_loadu2_m128i((const __m128i*)&table[j][(lo_1 >> (8 * j)) & 0xFF],
+                                                            (const __m128i*)&table[j][(lo_0 >> (8 * j)) & 0xFF]));
+                y = _mm256_xor_si256(y, _mm256_loadu2_m128i((const __m128i*)&table[j + 8][(hi_1 >> (8 * j)) & 0xFF],
+                                                            (const __m128i*)&table[j + 8][(hi_0 >> (8 * j)) & 0xFF]));
+            }
+            x = y;
+        }
+        x = _mm256_xor_si256(x, round_key_avx2(keys, first + n, 9));
+        _mm256_storeu_si256((__m256i*)&blocks[n], x);
+    }
+    encrypt_blocks_sse2(table, keys, blocks + n, count - n, first + n); // Оставшийся нечётный блок
+}
+
+// Итерационный ключ раунда для четырёх соседних блоков в ZMM
+template <typename key_source>
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i round_key_avx512(key_source keys, size_t n, int round)
+{
+    if (key_source::is_shared)
+        return _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)&keys.get(n, round)));
+    __m512i key = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)&keys.get(n, round)));
+    key = _mm512_inserti32x4(key, _mm_loadu_si128((const __m128i*)&keys.get(n + 1, round)), 1);
+    key = _mm512_inserti32x4(key, _mm_loadu_si128((const __m128i*)&keys.get(n + 2, round)), 2);
+    return _mm512_inserti32x4(key, _mm_loadu_si128((const __m128i*)&keys.get(n + 3, round)), 3);
+}
+
+// AVX-512: четыре блока в ZMM. Для каждой позиции байта pshufb (vpshufb) раскладывает j-й байт
+// каждого блока в оба его 64-битных слова, из них получаются индексы для одной сборки (gather) 8 слов
+template <typename key_source>
+__attribute__((target("avx512f,avx512bw")))
+static void encrypt_blocks_avx512(const block table[][UCHAR_MAX + 1], key_source keys, block blocks[], size_t count)
+{
+    const __m512i word_offset = _mm512_set_epi64(1, 0, 1, 0, 1, 0, 1, 0); // Младшее или старшее слово записи
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4)
+    {
+        __m512i x = _mm512_loadu_si512(&blocks[n]);
+        for (int i = 0; i < 9; i++)
+        {
+            x = _mm512_xor_si512(x, round_key_avx512(keys, n, i));
+            __m512i y = _mm512_setzero_si512();
+            for (int j = 0; j < 16; j++)
+            {
+                // Байт j в младший байт каждого слова, остальные байты обнуляются (индекс 0x80)
+                __m512i selector = _mm512_set1_epi64((long long)(0x8080808080808000ULL | (uint64_t)j));
+                __m512i index = _mm512_shuffle_epi8(x, selector);
+                index = _mm512_add_epi64(_mm512_slli_epi64(index, 1), word_offset);
+                y = _mm512_xor_si512(y, _mm512_i64gather_epi64(index, (const long long*)&table[j][0], 8));
+            }
+            x = y;
+        }
+        x = _mm512_xor_si512(x, round_key_avx512(keys, n, 9));
+        _mm512_storeu_si512(&blocks[n], x);
+    }
+    encrypt_blocks_avx2(table, keys, blocks + n, count - n, n); // Оставшиеся 1–3 блока
+}
+#endif
+
+bool simd_isa_supported(simd_isa isa)
+{
+    switch (isa)
+    {
+        case simd_isa::generic:
+            return true;
+#ifdef KUZNECHIK_X86_SIMD
+        case simd_isa::sse2:
+            return true; // Входит в базовый набор x86-64
+        case simd_isa::avx2:
+            return __builtin_cpu_supports("avx2");
+        case simd_isa::avx512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+        default:
+            return false;
+    }
+}
+
+simd_isa detect_simd_isa()
+{
+    if (simd_isa_supported(simd_isa::avx512))
+        return simd_isa::avx512;
+    if (simd_isa_supported(simd_isa::avx2))
+        return simd_isa::avx2;
+    if (simd_isa_supported(simd_isa::sse2))
+        return simd_isa::sse2;
+    return simd_isa::generic;
+}
+
+// Выбранный набор инструкций: определяется при первом обращении, может быть переопределён set_simd_isa
+static std::atomic<simd_isa>& selected_simd_isa()
+{
+    static std::atomic<simd_isa> selected(detect_simd_isa());
+    return selected;
+}
+
+void set_simd_isa(simd_isa isa)
+{
+    assert(simd_isa_supported(isa) && "Instruction set is not supported by this CPU");
+    selected_simd_isa() = isa;
+}
+
+simd_isa get_simd_isa()
+{
+    return selected_simd_isa();
+}
+
+const char* simd_isa_name(simd_isa isa)
+{
+    switch (isa)
+    {
+        case simd_isa::sse2: return "sse2";
+        case simd_isa::avx2: return "avx2";
+        case simd_isa::avx512: return "avx512";
+        default: return "generic";
+    }
+}
+
+// Выбор ядра по набору инструкций
+template <typename key_source>
+static void encrypt_blocks_dispatch(const block table[][UCHAR_MAX + 1], key_source keys, block blocks[], size_t count)
+{
+    switch (get_simd_isa())
+    {
+#ifdef KUZNECHIK_X86_SIMD
+        case simd_isa::avx512:
+            encrypt_blocks_avx512(table, keys, blocks, count);
+            return;
+        case simd_isa::avx2:
+            encrypt_blocks_avx2(table, keys, blocks, count);
+            return;
+        case simd_isa::sse2:
+            encrypt_blocks_sse2(table, keys, blocks, count);
+            return;
+#endif
+        default:
+            encrypt_blocks_generic(table, keys, blocks, count);
+    }
+}
+
+void encrypt_blocks_generic(const block table[][UCHAR_MAX + 1], const block keys[], block blocks[], size_t count)
+{
+    encrypt_blocks_generic(table, shared_keys{keys}, blocks, count);
+}
+
+void encrypt_blocks_simd(const block table[][UCHAR_MAX + 1], const block keys[], block blocks[], size_t count)
+{
+    encrypt_blocks_dispatch(table, shared_keys{keys}, blocks, count);
+}
+
+void encrypt_blocks_generic_multikey(const block table[][UCHAR_MAX + 1], const block* const keys[], block blocks[], size_t count)
+{
+    encrypt_blocks_generic(table, per_block_keys{keys}, blocks, count);
+}
+
+void encrypt_blocks_simd_multikey(const block table[][UCHAR_MAX + 1], const block* const keys[], block blocks[], size_t count)
+{
+    encrypt_blocks_dispatch(table, per_block_keys{keys}, blocks, count);
+}
+
+// Цепочка CBC-MAC: блок зависит от предыдущего, поэтому чередовать нечего и скорость определяет задержка
+// одного раунда; состояние и итерационные ключи не покидают регистров между блоками
+block cbc_mac_blocks_generic(const block table[][UCHAR_MAX + 1], const block keys[], block state, const unsigned char* data, size_t count)
+{
+    for (size_t n = 0; n < count; n++)
+    {
+        state ^= block(data + n * block::size);
+        encrypt_blocks_generic(table, shared_keys{keys}, &state, 1);
+    }
+    return state;
+}
+
+#ifdef KUZNECHIK_X86_SIMD
+// Один блок в XMM (векторные регистры шире не помогают: в цепочке всегда один блок)
+static block cbc_mac_blocks_sse2(const block table[][UCHAR_MAX + 1], const block keys[], block state, const unsigned char* data, size_t count)
+{
+    __m128i round_keys[10];
+    for (int i = 0; i < 10; i++)
+        round_keys[i] = _mm_loadu_si128((const __m128i*)&keys[i]);
+    __m128i x = _mm_loadu_si128((const __m128i*)&state);
+    for (size_t n = 0; n < count; n++)
+    {
+        x = _mm_xor_si128(x, _mm_loadu_si128((const __m128i*)(data + n * block::size)));
+        for (int i = 0; i < 9; i++)
+            x = ls_round_sse2(table, _mm_xor_si128(x, round_keys[i]));
+        x = _mm_xor_si128(x, round_keys[9]);
+    }
+    _mm_storeu_si128((__m128i*)&state, x);
+    return state;
+}
+#endif
+
+block cbc_mac_blocks_simd(const block table[][UCHAR_MAX + 1], const block keys[], block state, const unsigned char* data, size_t count)
+{
+#ifdef KUZNECHIK_X86_SIMD
+    if (get_simd_isa() != simd_isa::generic)
+        return cbc_mac_blocks_sse2(table, keys, state, data, count);
+#endif
+    return cbc_mac_blocks_generic(table, keys, state, data, count);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include "kuznechik_block.h"
+
+// Набор инструкций, которым считаются раунды в движке engine_type::simd
+enum class simd_isa
+{
+    generic, // Переносимый вариант на 64-битных словах
+    sse2,    // Один блок в регистре XMM
+    avx2,    // Два блока в регистре YMM
+    avx512   // Четыре блока в регистре ZMM
+};
+
+// Самый быстрый набор инструкций, поддерживаемый процессором (через cpuid)
+simd_isa detect_simd_isa();
+// Проверка, поддерживает ли процессор набор инструкций
+bool simd_isa_supported(simd_isa isa);
+// Принудительный выбор набора инструкций для всего процесса
+void set_simd_isa(simd_isa isa);
+// Текущий выбранный набор инструкций (при первом вызове определяется через cpuid)
+simd_isa get_simd_isa();
+// Название набора инструкций для вывода
+const char* simd_isa_name(simd_isa isa);
+
+// Шифрование count блоков на месте через таблицы L∘S
+// - table: таблицы L∘S (16×256 блоков)
+// - keys: 10 итерационных ключей
+void encrypt_blocks_generic(const block table[][UCHAR_MAX + 1], const block keys[], block blocks[], size_t count);
+// То же самое выбранным набором инструкций
+void encrypt_blocks_simd(const block table[][UCHAR_MAX + 1], const block keys[], block blocks[], size_t count);
+
+// Шифрование count блоков, у каждого блока свои итерационные ключи: blocks[n] шифруется ключами keys[n]
+// Блоки разных сообщений под разными ключами делят одни векторные регистры
+void encrypt_blocks_generic_multikey(const block table[][UCHAR_MAX + 1], const block* const keys[], block blocks[], size_t count);
+void encrypt_blocks_simd_multikey(const block table[][UCHAR_MAX + 1], const block* const keys[], block blocks[], size_t count);
+
+// Цепочка CBC-MAC для имитовставки: state = E(state ^ P_i) по count блокам data подряд, возвращается state
+// Блоки шифруются строго по очереди, поэтому используется путь с наименьшей задержкой одного блока
+block cbc_mac_blocks_generic(const block table[][UCHAR_MAX + 1], const block keys[], block state, const unsigned char* data, size_t count);
+block cbc_mac_blocks_simd(const block table[][UCHAR_MAX + 1], const block keys[], block state, const unsigned char* data, size_t count);
@@ -0,0 +1,110 @@
+#include "kuznechik.h"
+
+// Блоки можно шифровать прямо в выходном буфере, если порядок байтов в словах блока совпадает с памятью
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define KUZNECHIK_DIRECT_BLOCKS
+#endif
+
+size_t kuznechik::encrypted_size(size_t length) const
+{
+    if (mode == cipher_mode::mgm)
+        return length + block::size; // Имитовставка за шифртекстом
+    return is_length_preserving(mode) ? length : (length + block::size - 1) / block::size * block::size;
+}
+
+size_t kuznechik::decrypted_size(size_t length) const
+{
+    if (mode == cipher_mode::mgm)
+        return length >= block::size ? length - block::size : 0;
+    return is_length_preserving(mode) ? length : (length + block::size - 1) / block::size * block::size;
+}
+
+// Обработка буфера тем же способом, что и process_mapped: целые блоки окнами, неполный последний блок через копию
+void kuznechik::process_span(const unsigned char* input, unsigned char* output, size_t length, bool decrypt) const
+{
+    const size_t number_of_blocks = length / block::size;
+    block chaining_block = initialization_vector;
+    acpkm_chain acpkm;
+    auto process = [&](block blocks[], size_t count, uint64_t first_block)
+    {
+        if (decrypt)
+            decrypt_chunk(blocks, count, first_block, chaining_block, acpkm);
+        else
+            encrypt_chunk(blocks, count, first_block, chaining_block, acpkm);
+    };
+
+#ifdef KUZNECHIK_DIRECT_BLOCKS
+    if ((uintptr_t)output % alignof(block) == 0)
+    {
+        block* blocks = (block*)output;
+        const size_t window_blocks = span_window_size / block::size;
+        for (size_t i = 0; i < number_of_blocks; i += window_blocks)
+        {
+            const size_t count = std::min(window_blocks, number_of_blocks - i);
+            if (input != output)
+                memcpy(blocks + i, input + i * block::size, count * block::size);
+            process(blocks + i, count, i);
+        }
+    }
+    else
+#endif
+    {
+        block window[span_stack_blocks];
+        for (size_t i = 0; i < number_of_blocks; i += span_stack_blocks)
+        {
+            const size_t count = std::min(span_stack_blocks, number_of_blocks - i);
+            for (size_t j = 0; j < count; j++)
+                window[j] = block(input + (i + j) * block::size);
+            process(window, count, i);
+            for (size_t j = 0; j < count; j++)
+                window[j].store(output + (i + j) * block::size);
+        }
+    }
+
+    // Неполный последний блок дополняется пробелами; в режимах гаммирования дополнение не записывается
+    const size_t tail_length = length - number_of_blocks * block::size;
+    if (tail_length != 0)
+    {
+        unsigned char tail_bytes[block::size];
+        memset(tail_bytes, ' ', block::size);
+        memcpy(tail_bytes, input + number_of_blocks * block::size, tail_length);
+        block tail(tail_bytes);
+        process(&tail, 1, number_of_blocks);
+        tail.store(tail_bytes);
+        memcpy(output + number_of_blocks * block::size, tail_bytes, is_length_preserving(mode) ? tail_length : block::size);
+    }
+}
+
+void kuznechik::encrypt(std::span<const std::byte> input, std::span<std::byte> output, std::span<const std::byte> associated_data) const
+{
+    assert(output.size() >= encrypted_size(input.size()) && "Output buffer is too small");
+    assert((input.data() == output.data() || input.data() + input.size() <= output.data() || output.data() + output.size() <= input.data()) && "Input and output buffers overlap");
+    const unsigned char* input_bytes = (const unsigned char*)input.data();
+    unsigned char* output_bytes = (unsigned char*)output.data();
+    if (mode == cipher_mode::mgm)
+    {
+        mgm_encrypt(initialization_vector, (const unsigned char*)associated_data.data(), associated_data.size(), input_bytes, output_bytes, input.size(), output_bytes + input.size());
+        return;
+    }
+    assert(associated_data.empty() && "Associated data is supported only in MGM");
+    process_span(input_bytes, output_bytes, input.size(), false);
+}
+
+bool kuznechik::decrypt(std::span<const std::byte> input, std::span<std::byte> output, std::span<const std::byte> associated_data) const
+{
+    assert(output.size() >= decrypted_size(input.size()) && "Output buffer is too small");
+    assert((input.data() == output.data() || input.data() + input.size() <= output.data() || output.data() + output.size() <= input.data()) && "Input and output buffers overlap");
+    const unsigned char* input_bytes = (const unsigned char*)input.data();
+    unsigned char* output_bytes = (unsigned char*)output.data();
+    if (mode == cipher_mode::mgm)
+    {
+        // Последние 16 байтов — имитовставка; при работе на месте она лежит за расшифрованными данными и не затирается
+        if (input.size() < block::size)
+            return false;
+        const size_t length = input.size() - block::size;
+        return mgm_decrypt(initialization_vector, (const unsigned char*)associated_data.data(), associated_data.size(), input_bytes, output_bytes, length, input_bytes + length);
+    }
+    assert(associated_data.empty() && "Associated data is supported only in MGM");
+    process_span(input_bytes, output_bytes, input.size(), true);
+    return true;
+}
@@ -0,0 +1,216 @@
+#include "kuznechik_stats.h"
+#include "kuznechik_pool.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <omp.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#define KUZNECHIK_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+#endif
+
+static std::atomic<bool> hardware_counters_flag(false);
+
+void enable_hardware_counters(bool enable)
+{
+    hardware_counters_flag = enable;
+}
+
+bool hardware_counters_enabled()
+{
+    return hardware_counters_flag;
+}
+
+cipher_stats& cipher_stats::operator+=(const cipher_stats& other)
+{
+    read_time += other.read_time;
+    hex_time += other.hex_time;
+    key_time += other.key_time;
+    cipher_time += other.cipher_time;
+    write_time += other.write_time;
+    total_time += other.total_time;
+    bytes += other.bytes;
+    files += other.files;
+    for (size_t i = 0; i < other.thread_blocks.size(); i++)
+        add_thread_blocks((int)i, other.thread_blocks[i]);
+    authentic = authentic && other.authentic;
+    authentication_failures += other.authentication_failures;
+    counters.has_cycles = counters.has_cycles || other.counters.has_cycles;
+    counters.has_instructions = counters.has_instructions || other.counters.has_instructions;
+    counters.has_cache_misses = counters.has_cache_misses || other.counters.has_cache_misses;
+    counters.has_task_clock = counters.has_task_clock || other.counters.has_task_clock;
+    counters.cycles += other.counters.cycles;
+    counters.instructions += other.counters.instructions;
+    counters.cache_misses += other.counters.cache_misses;
+    counters.task_clock += other.counters.task_clock;
+    return *this;
+}
+
+void cipher_stats::add_thread_blocks(const std::vector<uint64_t>& before)
+{
+    const std::vector<uint64_t> after = thread_pool::global().processed_items();
+    for (size_t i = 0; i < after.size(); i++)
+        add_thread_blocks((int)i, after[i] - (i < before.size() ? before[i] : 0));
+}
+
+void cipher_stats::add_thread_blocks(int thread, uint64_t count)
+{
+    if (thread_blocks.size() <= (size_t)thread)
+        thread_blocks.resize(thread + 1);
+    thread_blocks[thread] += count;
+}
+
+std::string cipher_stats::to_json() const
+{
+    char buffer[512];
+    std::string json = "{";
+    std::snprintf(buffer, sizeof(buffer), "\"read_seconds\": %.6f, \"hex_seconds\": %.6f, \"key_seconds\": %.6f, \"cipher_seconds\": %.6f, \"write_seconds\": %.6f, \"total_seconds\": %.6f",
+        read_time, hex_time, key_time, cipher_time, write_time, total_time);
+    json += buffer;
+    std::snprintf(buffer, sizeof(buffer), ", \"bytes\": %llu, \"files\": %llu, \"throughput_bytes_per_second\": %.1f, \"authentic\": %s, \"authentication_failures\": %llu",
+        (unsigned long long)bytes, (unsigned long long)files, throughput(), authentic ? "true" : "false", (unsigned long long)authentication_failures);
+    json += buffer;
+    json += ", \"thread_blocks\": [";
+    for (size_t i = 0; i < thread_blocks.size(); i++)
+        json += (i == 0 ? "" : ", ") + std::to_string(thread_blocks[i]);
+    json += "]";
+    const struct { bool available; const char* name; uint64_t value; } values[] =
+    {
+        {counters.has_cycles, "cycles", counters.cycles},
+        {counters.has_instructions, "instructions", counters.instructions},
+        {counters.has_cache_misses, "cache_misses", counters.cache_misses},
+        {counters.has_task_clock, "task_clock_ns", counters.task_clock}
+    };
+    for (const auto& value : values)
+        if (value.available)
+            json += std::string(", \"") + value.name + "\": " + std::to_string(value.value);
+    json += "}";
+    return json;
+}
+
+std::string cipher_stats::to_prometheus(const std::string& prefix) const
+{
+    char buffer[256];
+    std::string text;
+    text += "# HELP " + prefix + "_phase_seconds Time spent in each phase of the operation\n";
+    text += "# TYPE " + prefix + "_phase_seconds gauge\n";
+    const struct { const char* name; double value; } phases[] =
+    {
+        {"read", read_time}, {"hex", hex_time}, {"key", key_time}, {"cipher", cipher_time}, {"write", write_time}, {"total", total_time}
+    };
+    for (const auto& phase : phases)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%s_phase_seconds{phase=\"%s\"} %.6f\n", prefix.c_str(), phase.name, phase.value);
+        text += buffer;
+    }
+    const struct { bool available; const char* name; const char* help; uint64_t value; } totals[] =
+    {
+        {true, "bytes_total", "Data bytes processed", bytes},
+        {true, "files_total", "Files processed", files},
+        {true, "authentication_failures_total", "MGM tags that did not match", authentication_failures},
+        {counters.has_cycles, "cpu_cycles_total", "CPU cycles of all threads", counters.cycles},
+        {counters.has_instructions, "instructions_total", "Instructions retired by all threads", counters.instructions},
+        {counters.has_cache_misses, "cache_misses_total", "Cache misses of all threads", counters.cache_misses},
+        {counters.has_task_clock, "task_clock_nanoseconds_total", "CPU time of all threads", counters.task_clock}
+    };
+    for (const auto& total : totals)
+        if (total.available)
+        {
+            text += "# HELP " + prefix + "_" + total.name + " " + total.help + "\n";
+            text += "# TYPE " + prefix + "_" + total.name + " counter\n";
+            text += prefix + "_" + total.name + " " + std::to_string(total.value) + "\n";
+        }
+    text += "# HELP " + prefix + "_throughput_bytes_per_second Data bytes per second of total time\n";
+    text += "# TYPE " + prefix + "_throughput_bytes_per_second gauge\n";
+    std::snprintf(buffer, sizeof(buffer), "%s_throughput_bytes_per_second %.1f\n", prefix.c_str(), throughput());
+    text += buffer;
+    text += "# HELP " + prefix + "_thread_blocks_total Blocks processed by each pool thread\n";
+    text += "# TYPE " + prefix + "_thread_blocks_total counter\n";
+    for (size_t i = 0; i < thread_blocks.size(); i++)
+        text += prefix + "_thread_blocks_total{thread=\"" + std::to_string(i) + "\"} " + std::to_string(thread_blocks[i]) + "\n";
+    return text;
+}
+
+#ifdef KUZNECHIK_PERF_EVENTS
+// Счётчики в порядке hardware_counters: циклы, инструкции, промахи кэша, процессорное время
+static const struct { uint32_t type; uint64_t config; } counter_events[4] =
+{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}
+};
+
+// Счётчик одного потока; inherit добавляет потоки, которые он запустит позже (std::async в потоковой обработке)
+static int open_counter(int event, pid_t thread)
+{
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = counter_events[event].type;
+    attributes.config = counter_events[event].config;
+    attributes.inherit = 1;
+    attributes.exclude_kernel = 1; // Доступно без прав при perf_event_paranoid = 2
+    attributes.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attributes, thread, -1, -1, 0);
+}
+#endif
+
+stats_scope::stats_scope(cipher_stats& stats) : stats(stats), start(omp_get_wtime())
+{
+#ifdef KUZNECHIK_PERF_EVENTS
+    if (!hardware_counters_enabled())
+        return;
+    // Потоки пула уже запущены, inherit их не захватит: счётчики открываются для каждого потока процесса
+    std::vector<pid_t> threads;
+    if (DIR* tasks = opendir("/proc/self/task"))
+    {
+        while (dirent* entry = readdir(tasks))
+            if (entry->d_name[0] != '.')
+                threads.push_back((pid_t)atoi(entry->d_name));
+        closedir(tasks);
+    }
+    for (pid_t thread : threads)
+        for (int event = 0; event < 4; event++)
+            descriptors.push_back(open_counter(event, thread));
+    // Открытие счётчиков не входит в замер
+    start = omp_get_wtime();
+#endif
+}
+
+void stats_scope::finish()
+{
+    stats.total_time += omp_get_wtime() - start;
+#ifdef KUZNECHIK_PERF_EVENTS
+    bool* available[4] = {&stats.counters.has_cycles, &stats.counters.has_instructions, &stats.counters.has_cache_misses, &stats.counters.has_task_clock};
+    uint64_t* totals[4] = {&stats.counters.cycles, &stats.counters.instructions, &stats.counters.cache_misses, &stats.counters.task_clock};
+    for (size_t i = 0; i < descriptors.size(); i++)
+    {
+        uint64_t value;
+        if (descriptors[i] < 0 || read(descriptors[i], &value, sizeof(value)) != sizeof(value))
+            continue;
+        *available[i % 4] = true;
+        *totals[i % 4] += value;
+    }
+    for (int descriptor : descriptors)
+        if (descriptor >= 0)
+            close(descriptor);
+    descriptors.clear();
+#endif
+}
+
+stats_scope::~stats_scope()
+{
+#ifdef KUZNECHIK_PERF_EVENTS
+    for (int descriptor : descriptors)
+        if (descriptor >= 0)
+            close(descriptor);
+#endif
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Счётчики процессора за время операции (perf_event_open), суммарно по всем потокам процесса
+// Счётчик, который ядро не дало открыть (нет прав, виртуальная машина без PMU), остаётся недоступным
+struct hardware_counters
+{
+    bool has_cycles = false;
+    bool has_instructions = false;
+    bool has_cache_misses = false;
+    bool has_task_clock = false;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cache_misses = 0;
+    uint64_t task_clock = 0; // Процессорное время всех потоков, нс (программный счётчик, есть почти всегда)
+};
+
+// Статистика одной операции шифрования или расшифрования
+// Время фаз — суммарное время, проведённое в фазе; в потоковой обработке чтение и запись идут
+// одновременно с шифрованием, поэтому сумма фаз может превышать total_time
+struct cipher_stats
+{
+    double read_time = 0; // Чтение файлов (без декодирования hex)
+    double hex_time = 0; // Декодирование hex и кодирование в hex
+    double key_time = 0; // Развёртывание ключа (или получение из key_cache)
+    double cipher_time = 0; // Шифрование
+    double write_time = 0; // Запись файлов
+    double total_time = 0; // Вся операция от начала до конца
+
+    uint64_t bytes = 0; // Байтов данных (открытого текста или шифртекста без имитовставки)
+    uint64_t files = 0; // Обработано файлов
+    std::vector<uint64_t> thread_blocks; // Блоков, зашифрованных каждым потоком пула (индекс — номер потока)
+
+    bool authentic = true; // MGM: все имитовставки сошлись
+    uint64_t authentication_failures = 0; // MGM: файлов с несошедшейся имитовставкой
+
+    hardware_counters counters; // Заполняются, если включены (enable_hardware_counters)
+
+    // Байтов в секунду за всю операцию
+    double throughput() const { return total_time > 0 ? bytes / total_time : 0; }
+
+    // Сложение статистик нескольких операций (время, объёмы, блоки по потокам, счётчики)
+    cipher_stats& operator+=(const cipher_stats& other);
+    // Блоки, обработанные потоками пула с момента снимка before = thread_pool::global().processed_items()
+    void add_thread_blocks(const std::vector<uint64_t>& before);
+    // count блоков, обработанных потоком thread
+    void add_thread_blocks(int thread, uint64_t count);
+
+    // Экспорт: объект JSON и текстовый формат Prometheus (метрики с приставкой prefix_)
+    std::string to_json() const;
+    std::string to_prometheus(const std::string& prefix = "kuznechik") const;
+};
+
+// Включение счётчиков процессора для последующих операций (по умолчанию выключены: открытие стоит системных вызовов)
+void enable_hardware_counters(bool enable);
+bool hardware_counters_enabled();
+
+// Замер одной операции: общее время и, если включены, счётчики процессора
+// Создаётся в начале операции, finish дописывает total_time и counters в stats (до того, как stats
+// будет возвращена); деструктор только закрывает счётчики
+class stats_scope
+{
+    public:
+        explicit stats_scope(cipher_stats& stats);
+        ~stats_scope();
+        stats_scope(const stats_scope&) = delete;
+        stats_scope& operator=(const stats_scope&) = delete;
+
+        void finish();
+
+    private:
+        cipher_stats& stats;
+        double start;
+        std::vector<int> descriptors; // Счётчики perf_event_open: по четыре на поток
+};
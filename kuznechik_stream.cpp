@@ -0,0 +1,218 @@
+#include "kuznechik.h"
+#include <unistd.h>
+
+// Кусок потока: байты файла и те же данные в виде блоков
+struct stream_chunk
+{
+    std::vector<unsigned char> bytes; // Байты куска (место под дополнение последнего блока включено)
+    first_touch_buffer<block> blocks; // Блоки куска, страницы размещены у обрабатывающих их потоков
+    size_t length = 0; // Число прочитанных байтов, 0 — конец файла
+
+    stream_chunk(size_t size, size_t grain) : bytes(size), blocks(size / block::size, grain) {}
+};
+
+// Чтение очередного куска файла (не больше limit байтов), возвращает число прочитанных байтов
+// Время чтения и декодирования hex добавляется в stats (поля, которых не касаются другие фазы конвейера)
+static size_t read_chunk(std::ifstream& input_stream, std::vector<unsigned char>& bytes, uint64_t limit, bool is_hex, cipher_stats& stats)
+{
+    const size_t size = std::min((uint64_t)bytes.size(), limit);
+    double start = omp_get_wtime();
+    if (!is_hex)
+    {
+        input_stream.read((char*)bytes.data(), size);
+        stats.read_time += omp_get_wtime() - start;
+        return input_stream.gcount();
+    }
+    // В hex-файле на каждый байт приходится два символа: читаем кусками по hex_chunk_size символов
+    // и декодируем прямо в bytes; перевод строки в конце файла допускается
+    char hexadecimal[hex_chunk_size];
+    size_t length = 0;
+    double hex_time = 0;
+    while (length < size)
+    {
+        input_stream.read(hexadecimal, std::min(hex_chunk_size, 2 * (size - length)));
+        size_t read_length = input_stream.gcount();
+        // Пробельные символы в конце куска могут быть только концом файла, даже если кусок полный (перевод
+        // строки попал на границу кусков): они отбрасываются, а за ними в файле не должно быть ничего, кроме них
+        bool at_end = true;
+        if (read_length != 0 && isspace((unsigned char)hexadecimal[read_length - 1]))
+        {
+            while (read_length != 0 && isspace((unsigned char)hexadecimal[read_length - 1]))
+                read_length--;
+            input_stream >> std::ws;
+            at_end = input_stream.peek() == std::char_traits<char>::eof();
+        }
+        double hex_start = omp_get_wtime();
+        bool valid = at_end && hex_decode(hexadecimal, read_length, bytes.data() + length);
+        hex_time += omp_get_wtime() - hex_start;
+        assert(valid && "Wrong hexadecimal file");
+        length += read_length / 2;
+        if (!input_stream)
+            break;
+    }
+    stats.hex_time += hex_time;
+    stats.read_time += omp_get_wtime() - start - hex_time;
+    return length;
+}
+
+// Длина данных файла в байтах; в hex-файле — число hex-символов без пробельных символов в конце
+// (перевода строки), пополам
+static uint64_t file_data_length(std::ifstream& input_stream, bool is_hex)
+{
+    input_stream.seekg(0, std::ios::end);
+    uint64_t length = input_stream.tellg();
+    if (is_hex)
+    {
+        char c;
+        while (length != 0 && input_stream.seekg(length - 1) && input_stream.get(c) && isspace((unsigned char)c))
+            length--;
+        length /= 2;
+    }
+    input_stream.clear();
+    input_stream.seekg(0, std::ios::beg);
+    return length;
+}
+
+// Потоковая обработка файла с тремя буферами: пока текущий кусок шифруется, в буфер
+// позапрошлого (уже записанного) читается следующий, а предыдущий дописывается в файл
+// В режиме MGM куски шифруются вместе с подсчётом имитовставки, она дописывается после последнего куска
+cipher_stats kuznechik::process_stream(const char* input_file_name, const char* output_file_name, bool is_hex, bool decrypt) const
+{
+    static_assert(stream_chunk_size % (group_size * block::size) == 0, "Chunk must consist of whole groups");
+
+    cipher_stats stats;
+    stats_scope scope(stats);
+    stats.files = 1;
+
+    // MGM: начальные счётчики и сумма слагаемых имитовставки по всем кускам
+    // При расшифровании последние 16 байтов файла — имитовставка, данными считается всё до неё. Расшифрованные
+    // данные пишутся во временный файл, который получает имя выходного, только если имитовставка сошлась
+    const bool authenticated = mode == cipher_mode::mgm;
+    const std::string written_file_name = authenticated && decrypt ? std::string(output_file_name) + "." + std::to_string(getpid()) + ".tmp" : std::string(output_file_name);
+
+    std::ifstream input_stream(input_file_name, std::ios::binary);
+    assert(input_stream && "Can't find file");
+    std::ofstream output_stream(written_file_name, std::ios::binary);
+    assert(output_stream.is_open() && "Can't open file");
+
+    stream_chunk chunks[3] = {{stream_chunk_size, parallel_grain}, {stream_chunk_size, parallel_grain}, {stream_chunk_size, parallel_grain}};
+
+    block chaining_block = initialization_vector; // Регистр режимов с зацеплением между кусками
+    acpkm_chain acpkm; // Ключи секций CTR-ACPKM, цепочка продолжается от куска к куску
+    uint64_t first_block = 0; // Номер первого блока текущего куска в потоке
+
+    block y_1, z_1, tag_sum;
+    uint64_t data_limit = UINT64_MAX; // Сколько байтов данных прочитать из файла
+    if (authenticated)
+    {
+        mgm_counters(initialization_vector, y_1, z_1);
+        if (decrypt)
+        {
+            const uint64_t file_length = file_data_length(input_stream, is_hex);
+            data_limit = file_length >= block::size ? file_length - block::size : 0;
+        }
+    }
+    uint64_t read_length = 0; // Прочитано байтов данных
+
+    chunks[0].length = read_chunk(input_stream, chunks[0].bytes, data_limit, is_hex, stats);
+    read_length += chunks[0].length;
+    std::future<void> pending_write;
+    for (size_t n = 0; chunks[n % 3].length != 0; n++)
+    {
+        stream_chunk& current = chunks[n % 3];
+        stream_chunk& next = chunks[(n + 1) % 3];
+
+        // Неполный кусок — последний, следующий читать не нужно
+        std::future<size_t> pending_read;
+        if (current.length == stream_chunk_size)
+            pending_read = std::async(std::launch::async, read_chunk, std::ref(input_stream), std::ref(next.bytes), data_limit - read_length, is_hex, std::ref(stats));
+
+        double start = omp_get_wtime();
+        const size_t count = (current.length + block::size - 1) / block::size;
+        if (authenticated)
+        {
+            // MGM обрабатывает байты куска на месте, блоки H_i нумеруются вслед за предыдущими кусками
+            std::vector<uint64_t> items = thread_pool::global().processed_items();
+            tag_sum ^= mgm_process(y_1, z_1, first_block, first_block, current.bytes.data(), current.bytes.data(), current.length, decrypt);
+            stats.add_thread_blocks(items);
+        }
+        else
+        {
+            // Последний блок дополняется пробелами
+            memset(current.bytes.data() + current.length, ' ', count * block::size - current.length);
+            thread_pool::global().parallel_for(count, parallel_grain, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                    current.blocks[i] = block(current.bytes.data() + i * block::size);
+            });
+
+            std::vector<uint64_t> items = thread_pool::global().processed_items();
+            if (decrypt)
+                decrypt_chunk(current.blocks.data(), count, first_block, chaining_block, acpkm);
+            else
+                encrypt_chunk(current.blocks.data(), count, first_block, chaining_block, acpkm);
+            stats.add_thread_blocks(items);
+
+            thread_pool::global().parallel_for(count, parallel_grain, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                    current.blocks[i].store(current.bytes.data() + i * block::size);
+            });
+        }
+        stats.cipher_time += omp_get_wtime() - start;
+        first_block += count;
+
+        // В режимах гаммирования длина сохраняется: дополнение последнего блока не записывается
+        const size_t output_length = is_length_preserving(mode) ? current.length : count * block::size;
+        if (pending_write.valid())
+            pending_write.get();
+        pending_write = std::async(std::launch::async, [&output_stream, &current, output_length, &stats]
+        {
+            double write_start = omp_get_wtime();
+            output_stream.write((const char*)current.bytes.data(), output_length);
+            stats.write_time += omp_get_wtime() - write_start;
+        });
+
+        next.length = pending_read.valid() ? pending_read.get() : 0;
+        read_length += next.length;
+    }
+    if (pending_write.valid())
+        pending_write.get();
+
+    stats.bytes = read_length;
+
+    if (!authenticated)
+    {
+        scope.finish();
+        return stats;
+    }
+    unsigned char tag[block::size];
+    mgm_finish(z_1, tag_sum, 0, read_length, tag);
+    if (!decrypt)
+    {
+        output_stream.write((const char*)tag, block::size);
+        scope.finish();
+        return stats;
+    }
+    // Имитовставка из файла сравнивается без раннего выхода; при совпадении временный файл переименовывается
+    // в выходной, иначе удаляется (выходной файл не создаётся и не меняется)
+    std::vector<unsigned char> stored_tag(block::size);
+    unsigned char difference = read_chunk(input_stream, stored_tag, block::size, is_hex, stats) != block::size;
+    for (int i = 0; i < block::size; i++)
+        difference |= stored_tag[i] ^ tag[i];
+    output_stream.close();
+    if (difference != 0)
+    {
+        std::remove(written_file_name.c_str());
+        stats.authentic = false;
+        stats.authentication_failures = 1;
+    }
+    else
+    {
+        int renamed = std::rename(written_file_name.c_str(), output_file_name);
+        assert(renamed == 0 && "Can't write file");
+        (void)renamed;
+    }
+    scope.finish();
+    return stats;
+}
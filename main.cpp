@@ -1,26 +1,458 @@
 #include "kuznechik.h"
+#include "kuznechik_mac.h"
+#include "kuznechik_container.h"
+#include "kuznechik_shard.h"
+#include "kuznechik_dispatch.h"
 #include <iostream>
+#include <filesystem>
 
 int main(int argc, char* argv[])
 {
+    // Необязательные ключи:
+    // --engine=table|simd|bitsliced|reference — способ шифрования (по умолчанию табличный)
+    // --isa=generic|sse2|avx2|avx512 — набор инструкций для simd (по умолчанию лучший доступный)
+    // --mode=ecb|ctr|ctr-acpkm|cbc|cfb|ofb|mgm — режим шифрования (по умолчанию простая замена)
+    //   ctr-acpkm — CTR со сменой ключа каждые 256 КБ (для очень длинных потоков под одним ключом)
+    // --iv=<до 32 hex-символов> — синхропосылка (для CTR используются младшие 16 символов, для MGM — ICN)
+    // --decrypt — расшифровать файл вместо зашифрования
+    // --mac — вычислить имитовставку (ГОСТ Р 34.13-2015) одного или нескольких файлов вместо шифрования
+    // --mmap — работать с файлами через отображение в память вместо потокового чтения
+    // --in-place — зашифровать (расшифровать) файл на месте, через отображение в память
+    // --batch — обработать много файлов: аргументы — файлы, каталоги (рекурсивно) и @список (имя файла в строке)
+    // --no-io-uring — в пакетном режиме читать и писать файлы потоками вместо io_uring
+    // --container — зашифровать в контейнер с произвольным доступом (CTR кусками по 1 МБ) или расшифровать его
+    // --range=<смещение>:<длина> — при расшифровании контейнера извлечь только этот участок исходных данных
+    // --shards=<число> — зашифровать (расшифровать) файл в режиме CTR отдельными процессами по участкам и проверить
+    //   результат; повторный запуск перезапускает только несделанные участки; другой --mode отклоняется
+    // --shard-plan=<число> — только разбить файл на участки и записать описание (для запуска исполнителей на других машинах)
+    // --shard=<номер> — исполнитель: обработать один участок, аргумент — описание разбиения
+    // --shard-verify — проверить участки по описанию разбиения (аргумент), ключ не нужен
+    // --stats=json|prometheus — вывести статистику операции (время фаз, объём, блоки по потокам)
+    // --perf-counters — добавить в статистику счётчики процессора (perf_event_open)
+    // --threads=<число> — число потоков шифрования (по умолчанию по числу процессоров или OMP_NUM_THREADS)
+    // --affinity=<список процессоров> — закрепить потоки за процессорами, например 0-3,8,10
+    // --dispatch-profile=<файл> — пороги выбора движка и потоков: читать из файла, измеренные сохранять в него
+    engine_type engine = engine_type::table;
+    cipher_mode mode = cipher_mode::ecb;
+    block initialization_vector;
+    bool decrypt = false;
+    bool mac = false;
+    bool mapped = false;
+    bool in_place = false;
+    bool batch = false;
+    bool use_io_uring = true;
+    bool container = false;
+    uint64_t range_offset = 0;
+    uint64_t range_length = UINT64_MAX;
+    size_t shard_count = 0;
+    bool shard_plan_only = false;
+    size_t shard_index = SIZE_MAX;
+    bool shard_verify = false;
+    std::string stats_format;
+    std::string dispatch_profile_file;
+    int threads = 0;
+    std::vector<int> cpus;
+    int argument_index = 1;
+    for (; argument_index < argc && std::string(argv[argument_index]).rfind("--", 0) == 0; argument_index++)
+    {
+        std::string option = argv[argument_index];
+        if (option == "--engine=reference")
+            engine = engine_type::reference;
+        else if (option == "--engine=table")
+            engine = engine_type::table;
+        else if (option == "--engine=simd")
+            engine = engine_type::simd;
+        else if (option == "--engine=bitsliced")
+            engine = engine_type::bitsliced;
+        else if (option == "--mode=ecb")
+            mode = cipher_mode::ecb;
+        else if (option == "--mode=ctr")
+            mode = cipher_mode::ctr;
+        else if (option == "--mode=ctr-acpkm")
+            mode = cipher_mode::ctr_acpkm;
+        else if (option == "--mode=cbc")
+            mode = cipher_mode::cbc;
+        else if (option == "--mode=cfb")
+            mode = cipher_mode::cfb;
+        else if (option == "--mode=ofb")
+            mode = cipher_mode::ofb;
+        else if (option == "--mode=mgm")
+            mode = cipher_mode::mgm;
+        else if (option == "--decrypt")
+            decrypt = true;
+        else if (option == "--mac")
+            mac = true;
+        else if (option == "--mmap")
+            mapped = true;
+        else if (option == "--in-place")
+            mapped = in_place = true;
+        else if (option == "--batch")
+            batch = true;
+        else if (option == "--no-io-uring")
+            use_io_uring = false;
+        else if (option == "--container")
+            container = true;
+        else if (option.rfind("--range=", 0) == 0)
+        {
+            std::string range = option.substr(8);
+            size_t colon = range.find(':');
+            if (colon == std::string::npos || colon == 0 || colon == range.length() - 1 || range.find_first_not_of("0123456789:") != std::string::npos || range.find(':', colon + 1) != std::string::npos)
+            {
+                std::cerr << "Wrong range: " << range << std::endl;
+                return 1;
+            }
+            range_offset = std::stoull(range.substr(0, colon));
+            range_length = std::stoull(range.substr(colon + 1));
+        }
+        else if (option.rfind("--shards=", 0) == 0 || option.rfind("--shard-plan=", 0) == 0 || option.rfind("--shard=", 0) == 0)
+        {
+            std::string number = option.substr(option.find('=') + 1);
+            if (number.empty() || number.length() > 9 || number.find_first_not_of("0123456789") != std::string::npos || (option[7] != '=' && std::stoul(number) == 0))
+            {
+                std::cerr << "Wrong number of shards: " << number << std::endl;
+                return 1;
+            }
+            if (option[7] == '=')
+                shard_index = std::stoul(number);
+            else
+            {
+                shard_count = std::stoul(number);
+                shard_plan_only = option[7] == '-';
+            }
+        }
+        else if (option == "--shard-verify")
+            shard_verify = true;
+        else if (option == "--stats=json" || option == "--stats=prometheus")
+            stats_format = option.substr(8);
+        else if (option == "--perf-counters")
+            enable_hardware_counters(true);
+        else if (option.rfind("--iv=", 0) == 0)
+        {
+            // Синхропосылка — 128-битное число: старшие 16 hex-символов — байты 8–15, младшие — байты 0–7
+            std::string hexadecimal_iv = option.substr(5);
+            if (hexadecimal_iv.empty() || hexadecimal_iv.length() > 32 || hexadecimal_iv.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+            {
+                std::cerr << "Wrong initialization vector: " << hexadecimal_iv << std::endl;
+                return 1;
+            }
+            hexadecimal_iv.insert(0, 32 - hexadecimal_iv.length(), '0');
+            initialization_vector = block(std::stoull(hexadecimal_iv.substr(16), nullptr, 16), std::stoull(hexadecimal_iv.substr(0, 16), nullptr, 16));
+        }
+        else if (option.rfind("--threads=", 0) == 0)
+        {
+            threads = std::atoi(option.c_str() + 10);
+            if (threads <= 0)
+            {
+                std::cerr << "Wrong number of threads: " << option.substr(10) << std::endl;
+                return 1;
+            }
+        }
+        else if (option.rfind("--affinity=", 0) == 0)
+        {
+            // Список процессоров через запятую, допускаются диапазоны: 0-3,8,10
+            std::string list = option.substr(11);
+            for (size_t position = 0; position < list.length();)
+            {
+                size_t comma = list.find(',', position);
+                if (comma == std::string::npos)
+                    comma = list.length();
+                std::string item = list.substr(position, comma - position);
+                size_t dash = item.find('-');
+                if (item.empty() || item.find_first_not_of("0123456789-") != std::string::npos || dash == 0 || dash == item.length() - 1)
+                {
+                    std::cerr << "Wrong CPU list: " << list << std::endl;
+                    return 1;
+                }
+                int first = std::stoi(item.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++)
+                    cpus.push_back(cpu);
+                position = comma + 1;
+            }
+        }
+        else if (option.rfind("--dispatch-profile=", 0) == 0)
+            dispatch_profile_file = option.substr(19);
+        else if (option.rfind("--isa=", 0) == 0)
+        {
+            std::string isa_name = option.substr(6);
+            bool found = false;
+            for (simd_isa isa : {simd_isa::generic, simd_isa::sse2, simd_isa::avx2, simd_isa::avx512})
+                if (isa_name == simd_isa_name(isa) && simd_isa_supported(isa))
+                {
+                    set_simd_isa(isa);
+                    found = true;
+                }
+            if (!found)
+            {
+                std::cerr << "Unsupported instruction set: " << isa_name << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
     // Проверяем, передан ли аргумент с именем файла
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <input_filename>" << std::endl;
+    if (argc != argument_index + 1 && !((mac || batch) && argc > argument_index)) {
+        std::cerr << "Usage: " << argv[0] << " [--engine=table|simd|bitsliced|reference] [--isa=generic|sse2|avx2|avx512] [--mode=ecb|ctr|ctr-acpkm|cbc|cfb|ofb|mgm] [--iv=<hex>] [--decrypt] [--mmap] [--in-place] [--threads=<n>] [--affinity=<cpus>] [--dispatch-profile=<file>] [--stats=json|prometheus] [--perf-counters] <input_filename>" << std::endl;
+        std::cerr << "       " << argv[0] << " --mac [--engine=...] [--threads=<n>] <input_filename>..." << std::endl;
+        std::cerr << "       " << argv[0] << " --container [--engine=...] [--iv=<hex>] [--decrypt [--range=<offset>:<length>]] <input_filename>" << std::endl;
+        std::cerr << "       " << argv[0] << " --shards=<n>|--shard-plan=<n> [--engine=...] [--iv=<hex>] [--decrypt] <input_filename>" << std::endl;
+        std::cerr << "       " << argv[0] << " --shard=<i>|--shard-verify [--engine=...] <manifest>" << std::endl;
+        std::cerr << "       " << argv[0] << " --batch [--engine=...] [--mode=...] [--decrypt] [--no-io-uring] <file|directory|@list>..." << std::endl;
         std::cerr << "Example: " << argv[0] << " beatles.txt" << std::endl;
         return 1;
     }
 
+    // Пул потоков создаётся один раз с заданным числом потоков; основной поток работает в нём же
+    if (threads != 0 || !cpus.empty())
+    {
+        thread_pool::configure(threads != 0 ? threads : (int)(cpus.empty() ? 0 : cpus.size()), cpus);
+        if (!cpus.empty())
+            thread_pool::pin_current_thread(cpus[0]);
+    }
+    if (!dispatch_profile_file.empty())
+        dispatch_profile::global().set_file(dispatch_profile_file.c_str());
+
     char key_1[] = "aaadefgpqrstuvws"; //just random 16-byte key
     char key_2[] = "bBbbbbebbeaaaaas"; //just random 16-byte key
     char key_hex[] = "8899aabbccddeeff0011223344556677fedcba98765432100123456789abcdef"; //hex key
 
+    // Время шифрования и, если запрошена, полная статистика операции
+    auto report = [&](const cipher_stats& stats)
+    {
+        std::cout << (decrypt ? "Decryption time: " : "Encryption time: ") << stats.cipher_time << "s" << std::endl;
+        if (stats_format == "json")
+            std::cout << stats.to_json() << std::endl;
+        else if (stats_format == "prometheus")
+            std::cout << stats.to_prometheus();
+    };
+
+    if (mac)
+    {
+        // Имитовставки всех файлов считаются вместе, вывод как у sha256sum: <hex>  <файл>
+        const size_t number_of_files = argc - argument_index;
+        std::vector<unsigned char> macs(number_of_files * block::size);
+        double start = omp_get_wtime();
+        mac_files(argv + argument_index, number_of_files, key_1, key_2, macs.data(), engine);
+        double end = omp_get_wtime();
+        for (size_t m = 0; m < number_of_files; m++)
+        {
+            char hexadecimal_mac[2 * block::size];
+            hex_encode(macs.data() + m * block::size, block::size, hexadecimal_mac);
+            std::cout.write(hexadecimal_mac, sizeof(hexadecimal_mac)) << "  " << argv[argument_index + m] << std::endl;
+        }
+        std::cerr << "MAC time: " << end - start << "s" << std::endl;
+        return 0;
+    }
+
+    if (batch)
+    {
+        // Каждый аргумент даёт в output/ одноимённый файл или каталог с приставкой encrypted_ (decrypted_ вместо
+        // encrypted_ при расшифровании), внутри каталога сохраняется его структура
+        namespace fs = std::filesystem;
+        std::vector<std::string> input_files, output_files;
+        auto add_file = [&](const fs::path& input, const fs::path& output)
+        {
+            fs::create_directories(output.parent_path());
+            input_files.push_back(input.string());
+            output_files.push_back(output.string());
+        };
+        auto add_argument = [&](const fs::path& input)
+        {
+            std::string name = input.lexically_normal().filename().string();
+            if (name.empty())
+                name = input.lexically_normal().parent_path().filename().string();
+            if (decrypt && name.rfind("encrypted_", 0) == 0)
+                name = name.substr(10);
+            const fs::path output = fs::path("output") / ((decrypt ? "decrypted_" : "encrypted_") + name);
+            if (!fs::is_directory(input))
+            {
+                add_file(input, output);
+                return;
+            }
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input))
+                if (entry.is_regular_file())
+                    add_file(entry.path(), output / fs::relative(entry.path(), input));
+        };
+        for (int a = argument_index; a < argc; a++)
+        {
+            std::string argument = argv[a];
+            if (argument[0] != '@')
+            {
+                add_argument(argument);
+                continue;
+            }
+            std::ifstream list(argument.substr(1));
+            assert(list && "Can't find file");
+            for (std::string line; std::getline(list, line);)
+                if (!line.empty())
+                    add_argument(line);
+        }
+
+        kuznechik cipher{block(key_1), block(key_2)};
+        cipher.set_engine(engine);
+        cipher.set_mode(mode, initialization_vector);
+        cipher_stats stats;
+        if (decrypt)
+            stats = cipher.decrypt_files(input_files, output_files, use_io_uring);
+        else
+            stats = cipher.encrypt_files(input_files, output_files, use_io_uring);
+        report(stats);
+        if (!stats.authentic)
+        {
+            std::cerr << "Authentication failed: " << stats.authentication_failures << " of " << input_files.size() << " files" << std::endl;
+            return 1;
+        }
+        std::cout << (decrypt ? "Decryption" : "Encryption") << " completed: " << input_files.size() << " files" << std::endl;
+        return 0;
+    }
+
     // Получаем имя входного файла из аргументов
-    std::string inputFile = argv[1];
-    
-    std::string encryptedFile = "output/encrypted_" + inputFile;
+    std::string inputFile = argv[argument_index];
+    // Результат кладётся в output/ под именем файла без каталогов
+    std::string baseName = inputFile.substr(inputFile.find_last_of('/') + 1);
+
+    if (container)
+    {
+        // Контейнер всегда в режиме CTR; синхропосылка хранится в нём, при расшифровании --iv не нужен
+        if (!decrypt)
+        {
+            std::string encryptedFile = "output/encrypted_" + baseName;
+            report(encrypt_container(inputFile.c_str(), encryptedFile.c_str(), key_1, key_2, engine, initialization_vector));
+            std::cout << "Encryption completed: " << encryptedFile << std::endl;
+            return 0;
+        }
+        if (baseName.rfind("encrypted_", 0) == 0)
+            baseName = baseName.substr(10);
+        std::string decryptedFile = "output/decrypted_" + baseName;
+        if (range_length == UINT64_MAX)
+            report(decrypt_container(inputFile.c_str(), decryptedFile.c_str(), key_1, key_2, engine));
+        else
+        {
+            // Участок расшифровывается по таблице кусков, остальной контейнер не читается
+            container_reader reader(inputFile.c_str(), block(key_1), block(key_2), engine);
+            std::vector<std::byte> bytes((size_t)std::min<uint64_t>(range_length, range_offset < reader.length() ? reader.length() - range_offset : 0));
+            double start = omp_get_wtime();
+            const size_t length = reader.read(range_offset, bytes);
+            std::cout << "Decryption time: " << omp_get_wtime() - start << "s" << std::endl;
+            std::ofstream output_stream(decryptedFile, std::ios::binary);
+            assert(output_stream.is_open() && "Can't open file");
+            output_stream.write((const char*)bytes.data(), length);
+        }
+        std::cout << "Decryption completed: " << decryptedFile << std::endl;
+        return 0;
+    }
+
+    if ((shard_index != SIZE_MAX || shard_verify || shard_count != 0) && mode != cipher_mode::ecb && mode != cipher_mode::ctr)
+    {
+        std::cerr << "Shards are always processed in CTR mode: use the default mode or --mode=ctr" << std::endl;
+        return 1;
+    }
+
+    if (shard_index != SIZE_MAX)
+    {
+        // Исполнитель: аргумент — описание разбиения, запись о завершении появляется рядом с ним
+        report(process_shard(inputFile.c_str(), shard_index, key_1, key_2, engine));
+        std::cout << "Shard " << shard_index << " completed" << std::endl;
+        return 0;
+    }
+
+    if (shard_verify || shard_count != 0)
+    {
+        // Участки — режим CTR, зашифрование и расшифрование совпадают; различаются только имена в output/
+        std::string manifestFile = inputFile;
+        if (!shard_verify)
+        {
+            if (decrypt && baseName.rfind("encrypted_", 0) == 0)
+                baseName = baseName.substr(10);
+            const std::string outputFile = (decrypt ? "output/decrypted_" : "output/encrypted_") + baseName;
+            manifestFile = outputFile + ".manifest";
+            const shard_manifest manifest = plan_shards(manifestFile.c_str(), inputFile.c_str(), outputFile.c_str(), shard_count, initialization_vector);
+            std::cout << "Shard manifest: " << manifestFile << " (" << manifest.shards.size() << " shards)" << std::endl;
+            if (shard_plan_only)
+                return 0;
+
+            // Исполнители — копии этой программы с теми же ключами, потоки делятся между ними поровну
+            const std::vector<size_t> pending = verify_shards(manifestFile.c_str());
+            std::vector<std::string> command = {"/proc/self/exe"};
+            for (int a = 1; a < argument_index; a++)
+            {
+                const std::string option = argv[a];
+                if (option.rfind("--shard", 0) != 0 && option.rfind("--threads=", 0) != 0 && option != "--decrypt")
+                    command.push_back(option);
+            }
+            const size_t workers = std::min(pending.size(), manifest.shards.size());
+            const int worker_threads = threads != 0 ? threads : thread_pool::global().size();
+            command.push_back("--threads=" + std::to_string(std::max<int>(1, worker_threads / std::max<size_t>(workers, 1))));
+            double start = omp_get_wtime();
+            const std::vector<size_t> failed = run_shard_workers(command, manifestFile.c_str(), pending, std::max<size_t>(workers, 1));
+            std::cout << (decrypt ? "Decryption time: " : "Encryption time: ") << omp_get_wtime() - start << "s" << std::endl;
+            for (size_t index : failed)
+                std::cerr << "Shard " << index << " worker failed" << std::endl;
+        }
+        const std::vector<size_t> failed = verify_shards(manifestFile.c_str());
+        if (!failed.empty())
+        {
+            std::cerr << "Shards to rerun:";
+            for (size_t index : failed)
+                std::cerr << " " << index;
+            std::cerr << std::endl;
+            return 1;
+        }
+        std::cout << "All shards verified: " << manifestFile << std::endl;
+        return 0;
+    }
+
+    if (in_place && mode == cipher_mode::mgm)
+    {
+        std::cerr << "MGM files can't be processed in place: the tag changes the file length" << std::endl;
+        return 1;
+    }
+
+    if (in_place)
+    {
+        // Результат записывается поверх входного файла
+        if (decrypt)
+            report(decrypt_file_mapped(inputFile.c_str(), nullptr, key_1, key_2, engine, mode, initialization_vector));
+        else
+            report(encrypt_file_mapped(inputFile.c_str(), nullptr, key_1, key_2, engine, mode, initialization_vector));
+        std::cout << (decrypt ? "Decryption" : "Encryption") << " completed: " << inputFile << std::endl;
+        return 0;
+    }
+
+    if (decrypt)
+    {
+        // Расшифрование: output/encrypted_beatles.txt -> output/decrypted_beatles.txt
+        if (baseName.rfind("encrypted_", 0) == 0)
+            baseName = baseName.substr(10);
+        std::string decryptedFile = "output/decrypted_" + baseName;
+        cipher_stats stats;
+        if (mapped)
+            stats = decrypt_file_mapped(inputFile.c_str(), decryptedFile.c_str(), key_1, key_2, engine, mode, initialization_vector);
+        else
+            stats = decrypt_file(inputFile.c_str(), decryptedFile.c_str(), key_1, key_2, engine, mode, initialization_vector);
+        report(stats);
+        if (!stats.authentic)
+        {
+            // MGM: имитовставка не сошлась, расшифрованный файл удалён
+            std::cerr << "Authentication failed: " << inputFile << std::endl;
+            return 1;
+        }
+        std::cout << "Decryption completed: " << decryptedFile << std::endl;
+        return 0;
+    }
+
+    std::string encryptedFile = "output/encrypted_" + baseName;
 
     // Шифрование
-    encrypt_file(inputFile.c_str(), encryptedFile.c_str(), key_1, key_2);
+    if (mapped)
+        report(encrypt_file_mapped(inputFile.c_str(), encryptedFile.c_str(), key_1, key_2, engine, mode, initialization_vector));
+    else
+        report(encrypt_file(inputFile.c_str(), encryptedFile.c_str(), key_1, key_2, engine, mode, initialization_vector));
 
     std::cout << "Encryption completed: " << encryptedFile << std::endl;
 